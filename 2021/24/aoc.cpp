@@ -16,6 +16,11 @@
 #include <cmath>
 #include <string_view>
 #include <tuple>
+#include <map>
+#include <sstream>
+#include <unordered_map>
+#include <thread>
+#include <future>
 
 class Instruction
 {
@@ -53,9 +58,11 @@ public:
                 throw std::invalid_argument("Invalid register 1");
         }
 
+        m_arg2_is_literal = false;
+        m_arg2 = W;
+
         if (m_op != INP)
         {
-            m_arg2_is_literal = false;
             switch (arg2)
             {
                 case 'w': m_arg2 = W; break;
@@ -282,14 +289,245 @@ public:
     bool error;
 };
 
+/* One MONAD block translated once into a form that is cheap to evaluate for
+ * millions of z values.  Blocks following the usual 18 instruction layout
+ *
+ *     inp w / mul x 0 / add x z / mod x 26 / div z A / add x B / eql x w /
+ *     eql x 0 / mul y 0 / add y 25 / mul y x / add y 1 / mul z y / mul y 0 /
+ *     add y w / add y C / mul y x / add z y
+ *
+ * reduce to three constants.  Anything else is compiled into a flat op array
+ * with the literal operands already resolved.
+ */
+class CompiledBlock
+{
+public:
+
+    CompiledBlock() : m_Pattern(false), m_A(1), m_B(0), m_C(0) {};
+
+    /* With allow_pattern false the block is always compiled into the op array, which is used to check that path */
+    CompiledBlock(const std::vector<Instruction>& il, bool allow_pattern = true) : m_Pattern(false), m_A(1), m_B(0), m_C(0)
+    {
+        if (! (allow_pattern && match(il)))
+        {
+            for (auto &i: il)
+            {
+                Op op;
+                op.code = static_cast<uint8_t>(i.m_op * 2 + (((i.m_op != Instruction::INP) && i.m_arg2_is_literal) ? 1 : 0));
+                op.dst = i.m_arg1;
+                op.src = i.m_arg2;
+                op.literal = i.m_arg2_literal;
+                m_Ops.push_back(op);
+            }
+        }
+    }
+
+    bool isPattern() const { return m_Pattern; };
+
+    /* True if this block never brings a z >= 1 back to 0 other than through its division, so
+     * z / divisor() is a lower bound on the z it produces.
+     */
+    bool isMonotonic() const { return m_Pattern && (m_C >= -25); };
+    int64_t divisor() const { return m_A; };
+
+    /* Run the block with digit as input and z as the incoming z register.  Returns false where the interpreter
+     * would have reported an error.
+     */
+    bool evaluate(int64_t z, int64_t digit, int64_t& z_out) const
+    {
+        if (m_Pattern)
+        {
+            if (z < 0) return false;
+
+            bool push = ((z % 26) + m_B) != digit;
+            z /= m_A;
+            if (push)
+            {
+                z = z * 26 + digit + m_C;
+            }
+
+            z_out = z;
+            return true;
+        }
+
+        std::array<int64_t, 4> r{{0, 0, 0, z}};
+        bool input_used = false;
+
+        for (auto &op: m_Ops)
+        {
+            int64_t& dst = r[op.dst];
+
+            switch (op.code)
+            {
+            case Instruction::INP * 2:
+                if (input_used) return false;
+                dst = digit;
+                input_used = true;
+                break;
+            case Instruction::ADD * 2:     dst += r[op.src]; break;
+            case Instruction::ADD * 2 + 1: dst += op.literal; break;
+            case Instruction::MUL * 2:     dst *= r[op.src]; break;
+            case Instruction::MUL * 2 + 1: dst *= op.literal; break;
+            case Instruction::DIV * 2:
+                if (r[op.src] == 0) return false;
+                dst /= r[op.src];
+                break;
+            case Instruction::DIV * 2 + 1:
+                if (op.literal == 0) return false;
+                dst /= op.literal;
+                break;
+            case Instruction::MOD * 2:
+                if ((dst < 0) || (r[op.src] <= 0)) return false;
+                dst %= r[op.src];
+                break;
+            case Instruction::MOD * 2 + 1:
+                if ((dst < 0) || (op.literal <= 0)) return false;
+                dst %= op.literal;
+                break;
+            case Instruction::EQL * 2:     dst = (dst == r[op.src]) ? 1 : 0; break;
+            case Instruction::EQL * 2 + 1: dst = (dst == op.literal) ? 1 : 0; break;
+            default:
+                return false;
+            }
+        }
+
+        z_out = r[Instruction::Z];
+        return true;
+    }
+
+private:
+
+    struct Op
+    {
+        uint8_t code;
+        uint8_t dst;
+        uint8_t src;
+        int64_t literal;
+    };
+
+    bool match(const std::vector<Instruction>& il)
+    {
+        using I = Instruction;
+
+        /* Opcode, arg1, arg2 register or -1 for a literal, expected literal or -1 for one of the constants */
+        static const std::array<std::tuple<I::Opcode, I::Register, int, int64_t>, 18> layout{{
+            { I::INP, I::W,  0,   0 },
+            { I::MUL, I::X, -1,   0 },
+            { I::ADD, I::X, I::Z, 0 },
+            { I::MOD, I::X, -1,  26 },
+            { I::DIV, I::Z, -1,  -1 },
+            { I::ADD, I::X, -1,  -1 },
+            { I::EQL, I::X, I::W, 0 },
+            { I::EQL, I::X, -1,   0 },
+            { I::MUL, I::Y, -1,   0 },
+            { I::ADD, I::Y, -1,  25 },
+            { I::MUL, I::Y, I::X, 0 },
+            { I::ADD, I::Y, -1,   1 },
+            { I::MUL, I::Z, I::Y, 0 },
+            { I::MUL, I::Y, -1,   0 },
+            { I::ADD, I::Y, I::W, 0 },
+            { I::ADD, I::Y, -1,  -1 },
+            { I::MUL, I::Y, I::X, 0 },
+            { I::ADD, I::Z, I::Y, 0 },
+        }};
+
+        if (il.size() != layout.size()) return false;
+
+        for (std::size_t n = 0; n < layout.size(); ++n)
+        {
+            auto& [op, arg1, arg2, literal] = layout[n];
+            const I& i = il[n];
+
+            if ((i.m_op != op) || (i.m_arg1 != arg1)) return false;
+            if (op == I::INP) continue;
+
+            if (arg2 < 0)
+            {
+                if (! i.m_arg2_is_literal) return false;
+                if ((literal >= 0) && (i.m_arg2_literal != literal)) return false;
+            }
+            else if (i.m_arg2_is_literal || (i.m_arg2 != arg2))
+            {
+                return false;
+            }
+        }
+
+        m_A = il[4].m_arg2_literal;
+        m_B = il[5].m_arg2_literal;
+        m_C = il[15].m_arg2_literal;
+
+        if (m_A <= 0) return false;
+
+        m_Pattern = true;
+        return true;
+    }
+
+    bool m_Pattern;
+    int64_t m_A;
+    int64_t m_B;
+    int64_t m_C;
+    std::vector<Op> m_Ops;
+};
+
+/* Compare both compiled forms of a block against the interpreter for every digit over a spread of z values.  Negative
+ * z values make the interpreter fail, its complaints are muted while checking that both forms fail the same way.
+ */
+bool compiledMatches(const std::vector<Instruction>& il)
+{
+    CompiledBlock pattern(il);
+    CompiledBlock fallback(il, false);
+
+    std::vector<int64_t> zs;
+    for (int64_t z = -30; z < 1000; ++z)
+    {
+        zs.push_back(z);
+    }
+    for (int64_t z = 1000; z < 308915776; z = z * 7 + 3)
+    {
+        zs.push_back(z);
+    }
+
+    for (auto z : zs)
+    {
+        for (int64_t digit = 1; digit <= 9; ++digit)
+        {
+            Alu alu(digit, z);
+            bool ok = alu.execute(il);
+
+            for (auto *block : {&pattern, &fallback})
+            {
+                int64_t z_out = 0;
+                bool block_ok = block->evaluate(z, digit, z_out);
+
+                if ((block_ok != ok) || (ok && (z_out != alu.getZ())))
+                    return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void verifyCompiled(const std::vector<Instruction>& il)
+{
+    std::streambuf *saved = std::cerr.rdbuf(nullptr);
+    bool matches = compiledMatches(il);
+    std::cerr.rdbuf(saved);
+    std::cerr.clear();
+
+    if (! matches)
+        throw std::logic_error("Compiled block differs from interpreter");
+}
+
 class DigitSolver
 {
 public:
 
     DigitSolver() {};
-    DigitSolver(const std::vector<Instruction>& il) : instructions(il) {};
+    DigitSolver(const std::vector<Instruction>& il) : instructions(il), compiled(il) {};
 
     std::vector<Instruction> instructions;
+    CompiledBlock compiled;
 
     std::map<int64_t, std::set<std::pair<int64_t, int64_t>>> solutions;
 
@@ -300,53 +538,53 @@ public:
     bool first;
     int pos;
 
-    std::map<int64_t, std::set<int64_t>> output_universe_largest;
-    std::map<int64_t, std::set<int64_t>> output_universe_smallest;
+    /* z -> best model number prefix reaching it, spread over partitions by z hash so that each partition can be
+     * filled by its own thread.
+     */
+    using Universe = std::vector<std::unordered_map<int64_t, int64_t>>;
 
+    Universe output_universe_largest;
+    Universe output_universe_smallest;
 
-    void solve_for_largest()
+    /* Outputs at or above this z can no longer be divided down to 0 by the remaining blocks */
+    int64_t z_limit = std::numeric_limits<int64_t>::max();
+
+    static std::size_t partitions()
     {
-        if ((prev) && (prev->prev))
-        {
-            prev->prev->output_universe_largest.clear();
-        }
+        static const std::size_t n = std::max(1u, std::thread::hardware_concurrency());
+        return n;
+    }
 
-        if (prev)
-        {
-            for ( auto d : prev->output_universe_largest )
-            {
-                for (int i = 1; i<10; ++i)
-                {
-                    Alu alu( i, d.first );
+    static std::size_t partition(int64_t z)
+    {
+        return ((static_cast<uint64_t>(z) * 0x9E3779B97F4A7C15ULL) >> 32) % partitions();
+    }
 
-                    if (alu.execute(instructions))
-                    {
-                        if ((next) || alu.valid())
-                        {
-                            output_universe_largest[alu.getZ()].insert( ( i * factor ) + *d.second.rbegin() );
-                        }
-                    }
-                }
-            }
+    void prepare_limit()
+    {
+        z_limit = std::numeric_limits<int64_t>::max();
 
-        }
-        else
+        int64_t limit = 1;
+        for (DigitSolver* d = next; d; d = d->next)
         {
-            for (int i = 1; i<10; ++i)
-            {
-                Alu alu( i );
+            if (! d->compiled.isMonotonic()) return;
+            if (limit > std::numeric_limits<int64_t>::max() / d->compiled.divisor()) return;
+            limit *= d->compiled.divisor();
+        }
 
-                if (alu.execute(instructions))
-                {
-                    if ((next) || alu.valid())
-                    {
-                        output_universe_largest[alu.getZ()].insert( ( i * factor ) );
-                    }
-                }
-            }
+        z_limit = limit;
+    }
+
+    void solve_for_largest()
+    {
+        if ((prev) && (prev->prev))
+        {
+            prev->prev->output_universe_largest.clear();
         }
 
-        if (output_universe_largest.empty())
+        expand(prev ? &prev->output_universe_largest : nullptr, output_universe_largest, [](int64_t a, int64_t b) { return a > b; });
+
+        if (count(output_universe_largest) == 0)
         {
             throw std::logic_error("No solution for largest");
         }
@@ -359,42 +597,9 @@ public:
             prev->prev->output_universe_smallest.clear();
         }
 
-        if (prev)
-        {
-            for ( auto d : prev->output_universe_smallest )
-            {
-                for (int i = 1; i<10; ++i)
-                {
-                    Alu alu( i, d.first );
-
-                    if (alu.execute(instructions))
-                    {
-                        if ((next) || alu.valid())
-                        {
-                            output_universe_smallest[alu.getZ()].insert( ( i * factor ) + *d.second.begin() );
-                        }
-                    }
-                }
-            }
-
-        }
-        else
-        {
-            for (int i = 1; i<10; ++i)
-            {
-                Alu alu( i );
-
-                if (alu.execute(instructions))
-                {
-                    if ((next) || alu.valid())
-                    {
-                        output_universe_smallest[alu.getZ()].insert( ( i * factor ) );
-                    }
-                }
-            }
-        }
+        expand(prev ? &prev->output_universe_smallest : nullptr, output_universe_smallest, [](int64_t a, int64_t b) { return a < b; });
 
-        if (output_universe_smallest.empty())
+        if (count(output_universe_smallest) == 0)
         {
             throw std::logic_error("No solution for smallest");
         }
@@ -406,15 +611,25 @@ public:
         output_universe_largest.clear();
     }
 
+    static std::size_t count(const Universe& u)
+    {
+        std::size_t ret = 0;
+        for (auto &p: u)
+        {
+            ret += p.size();
+        }
+        return ret;
+    }
+
     int64_t getLargestSolution() const
     {
         int64_t largest = std::numeric_limits<int64_t>::min();
 
-        for (auto &s: output_universe_largest)
+        for (auto &p: output_universe_largest)
         {
-            if (! s.second.empty())
+            for (auto &s: p)
             {
-                largest = std::max( largest, *s.second.rbegin());
+                largest = std::max( largest, s.second );
             }
         }
 
@@ -425,16 +640,92 @@ public:
     {
         int64_t smallest = std::numeric_limits<int64_t>::max();
 
-        for (auto &s: output_universe_smallest)
+        for (auto &p: output_universe_smallest)
         {
-            if (! s.second.empty())
+            for (auto &s: p)
             {
-                smallest = std::min( smallest, *s.second.begin());
+                smallest = std::min( smallest, s.second );
             }
         }
 
         return smallest;
     }
+
+private:
+
+    /* Run this block for every z in the input universe and every digit.  Each worker takes a share of the input
+     * partitions and collects its results per output partition, the output partitions are then merged in parallel.
+     */
+    template<typename Better>
+    void expand(const Universe* input, Universe& output, Better better) const
+    {
+        const std::size_t n = partitions();
+
+        Universe first_input(1);
+        if (! input)
+        {
+            first_input[0].emplace(0, 0);
+            input = &first_input;
+        }
+
+        std::vector<Universe> local(n, Universe(n));
+        std::vector<std::future<void>> workers;
+
+        for (std::size_t w = 0; w < n; ++w)
+        {
+            workers.emplace_back(std::async(std::launch::async, [&, w]() {
+                Universe& mine = local[w];
+
+                for (std::size_t p = w; p < input->size(); p += n)
+                {
+                    for (auto &d: (*input)[p])
+                    {
+                        for (int i = 1; i<10; ++i)
+                        {
+                            int64_t z;
+
+                            if (! compiled.evaluate(d.first, i, z)) continue;
+                            if (next ? (z >= z_limit) : (z != 0)) continue;
+
+                            int64_t model = ( i * factor ) + d.second;
+                            auto [elm, inserted] = mine[partition(z)].emplace(z, model);
+                            if ((! inserted) && better(model, elm->second))
+                            {
+                                elm->second = model;
+                            }
+                        }
+                    }
+                }
+            }));
+        }
+
+        for (auto &w: workers) w.get();
+        workers.clear();
+
+        output.assign(n, {});
+
+        for (std::size_t q = 0; q < n; ++q)
+        {
+            workers.emplace_back(std::async(std::launch::async, [&, q]() {
+                auto& target = output[q];
+
+                for (auto &l: local)
+                {
+                    for (auto &e: l[q])
+                    {
+                        auto [elm, inserted] = target.emplace(e);
+                        if ((! inserted) && better(e.second, elm->second))
+                        {
+                            elm->second = e.second;
+                        }
+                    }
+                    l[q].clear();
+                }
+            }));
+        }
+
+        for (auto &w: workers) w.get();
+    }
 };
 
 int
@@ -546,6 +837,12 @@ main(int argc, char **argv)
 
     }
 
+    /* Both compiled forms have to agree with the interpreter before they are trusted */
+    for (auto &d : monad)
+    {
+        verifyCompiled(d.instructions);
+    }
+
     /* Prepare the data structure linking */
     for (auto i = monad.begin(); i != monad.end(); i = std::next(i))
     {
@@ -583,6 +880,11 @@ main(int argc, char **argv)
         factor *= 10;
     }
 
+    for (auto &d : monad)
+    {
+        d.prepare_limit();
+    }
+
     std::cout << "solving Smallest serial" << std::endl;
     for (auto i = monad.begin(); i != monad.end(); i = std::next(i))
     {
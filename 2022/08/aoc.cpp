@@ -12,6 +12,8 @@
 #include <exception>
 #include <deque>
 #include <iomanip>
+#include <future>
+#include <thread>
 
 class Grid
 {
@@ -231,15 +233,161 @@ private:
     std::vector<std::vector<Tree>> grid;
 };
 
+/* Flat forest : heights in one array.  Every row and column is scanned once from both ends, keeping for each height
+ * the position of the last tree seen with it.  The nearest tree at least as tall gives the viewing distance, and
+ * when there is none the tree is visible from that edge.
+ */
+class Forest
+{
+public:
+
+    Forest() : width(0), height(0) {};
+
+    void addLine(const std::string& line)
+    {
+        if ((height > 0) && (line.length() != width))
+            throw std::invalid_argument("Inconsistent grid size : '" + line +"'");
+
+        width = line.length();
+        height++;
+
+        for (auto& c : line)
+        {
+            if ((c < '0') || (c > '9'))
+                throw std::invalid_argument("Invalid tree height : '" + line +"'");
+
+            heights.push_back(c - '0');
+        }
+    }
+
+    void finalize()
+    {
+        visible.assign(heights.size(), 0);
+        scenic_score.assign(heights.size(), 1);
+
+        /* Rows first, then columns : within a pass no two lines share a tree, so they can run side by side */
+        forEachLine(height, [this](std::size_t y) {
+            scanLine(y * width, 1, width);
+            scanLine(y * width + width - 1, -1, width);
+        });
+
+        forEachLine(width, [this](std::size_t x) {
+            scanLine(x, width, height);
+            scanLine(x + (height - 1) * width, -(std::ptrdiff_t)width, height);
+        });
+    }
+
+    std::size_t countVisible() const
+    {
+        return std::count(visible.begin(), visible.end(), 1);
+    }
+
+    std::size_t highestScenicScore() const
+    {
+        return scenic_score.empty() ? 0 : *std::max_element(scenic_score.begin(), scenic_score.end());
+    }
+
+private:
+
+    void scanLine(std::size_t first, std::ptrdiff_t step, std::size_t count)
+    {
+        std::array<std::ptrdiff_t, 10> last;
+        last.fill(-1);
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            std::size_t c = first + i * step;
+            uint8_t h = heights[c];
+
+            std::ptrdiff_t blocker = -1;
+            for (std::size_t t = h; t < last.size(); ++t)
+            {
+                blocker = std::max(blocker, last[t]);
+            }
+
+            if (blocker < 0)
+            {
+                visible[c] = 1;
+                scenic_score[c] *= i;
+            }
+            else
+            {
+                scenic_score[c] *= i - blocker;
+            }
+
+            last[h] = i;
+        }
+    }
+
+    template<typename Scan>
+    void forEachLine(std::size_t lines, Scan scan)
+    {
+        std::size_t n_threads = std::max(1u, std::thread::hardware_concurrency());
+        std::size_t chunk = (lines + n_threads - 1) / n_threads;
+
+        std::vector<std::future<void>> workers;
+        for (std::size_t first = 0; first < lines; first += chunk)
+        {
+            std::size_t last = std::min(lines, first + chunk);
+
+            workers.emplace_back(std::async(std::launch::async, [&scan, first, last]() {
+                for (std::size_t l = first; l < last; ++l)
+                {
+                    scan(l);
+                }
+            }));
+        }
+
+        for (auto& w : workers)
+        {
+            w.get();
+        }
+    }
+
+    std::size_t width;
+    std::size_t height;
+
+    std::vector<uint8_t> heights;
+    std::vector<uint8_t> visible;
+    std::vector<std::size_t> scenic_score;
+};
+
 int
 main(int argc, char **argv)
 {
     if (argc < 2)
     {
-        fprintf(stderr, "Usage: %s datafilename\n", argv[0]);
+        fprintf(stderr, "Usage: %s datafilename [flat]\n", argv[0]);
         exit(-1);
     }
 
+    if ((argc > 2) && (std::string(argv[2]) == "flat"))
+    {
+        Forest forest;
+        try
+        {
+            std::ifstream infile(argv[1]);
+
+            std::string line;
+            while (std::getline(infile, line))
+            {
+                forest.addLine(line);
+            }
+        }
+        catch(std::exception& e)
+        {
+            std::cerr << "Reading data error: " << e.what() << std::endl;
+            std::exit(-1);
+        }
+
+        forest.finalize();
+
+        std::cout << forest.countVisible() << " trees visible" << std::endl;
+        std::cout << forest.highestScenicScore() << " highest scenice score" << std::endl;
+
+        return 0;
+    }
+
     Grid grid;
     try
     {
@@ -12,6 +12,10 @@
 #include <exception>
 #include <deque>
 #include <iomanip>
+#include <unordered_map>
+#include <memory>
+#include <chrono>
+#include <random>
 
 constexpr bool do_debug{false};
 
@@ -333,15 +337,197 @@ public:
     }
 };
 
+/* Set of visited cells as 64x64 bit tiles, allocated as the rope reaches them */
+class TiledBitmap
+{
+public:
+
+    TiledBitmap() : count(0), last_key(0), last_tile(nullptr) {};
+
+    void set(int x, int y)
+    {
+        uint64_t *tile = tileOf(x, y);
+        uint64_t bit = uint64_t(1) << (x & 63);
+        uint64_t& row = tile[y & 63];
+
+        if (! (row & bit))
+        {
+            row |= bit;
+            count++;
+        }
+    }
+
+    std::size_t size() const { return count; }
+
+private:
+
+    using Tile = std::array<uint64_t, 64>;
+
+    uint64_t *tileOf(int x, int y)
+    {
+        uint64_t key = (uint64_t(uint32_t(x >> 6)) << 32) | uint32_t(y >> 6);
+
+        if ((last_tile == nullptr) || (key != last_key))
+        {
+            auto& tile = tiles[key];
+            if (! tile)
+            {
+                tile = std::make_unique<Tile>();
+                tile->fill(0);
+            }
+
+            last_key = key;
+            last_tile = tile->data();
+        }
+
+        return last_tile;
+    }
+
+    std::size_t count;
+    uint64_t last_key;
+    uint64_t *last_tile;
+    std::unordered_map<uint64_t, std::unique_ptr<Tile>> tiles;
+};
+
+/* Rope of any length with absolute knot positions.  A step stops propagating at the first knot that doesn't move.
+ * Once a step moves every knot by the same amount as the head, the rope is pulled straight, and the rest of the
+ * command just translates it.
+ */
+class Rope
+{
+public:
+
+    Rope(std::size_t a_length) : knots(std::max<std::size_t>(a_length, 1), std::array<int, 2>{0, 0})
+    {
+        visits.set(0, 0);
+    }
+
+    void run(const std::vector<Command> &commands)
+    {
+        for (auto& c : commands)
+        {
+            runCommand(c);
+        }
+    }
+
+    void runCommand(const Command& command)
+    {
+        static const std::array<std::array<int, 2>, 4> deltas{{ {0, 1}, {1, 0}, {0, -1}, {-1, 0} }};
+        const std::array<int, 2>& delta = deltas[command.dir];
+
+        for (std::size_t s = 0; s < command.steps; ++s)
+        {
+            if (step(delta))
+            {
+                translate(delta, command.steps - s - 1);
+                break;
+            }
+        }
+    }
+
+    std::size_t countVisitedSites() const
+    {
+        return visits.size();
+    }
+
+private:
+
+    /* Returns true when every knot moved by delta */
+    bool step(const std::array<int, 2>& delta)
+    {
+        knots[0][0] += delta[0];
+        knots[0][1] += delta[1];
+
+        bool straight = true;
+
+        for (std::size_t i = 1; i < knots.size(); ++i)
+        {
+            int dx = knots[i - 1][0] - knots[i][0];
+            int dy = knots[i - 1][1] - knots[i][1];
+
+            if ((std::abs(dx) <= 1) && (std::abs(dy) <= 1))
+                /* This knot stays, so does the rest of the rope */
+                return false;
+
+            int mx = (dx > 0) - (dx < 0);
+            int my = (dy > 0) - (dy < 0);
+
+            knots[i][0] += mx;
+            knots[i][1] += my;
+
+            straight = straight && (mx == delta[0]) && (my == delta[1]);
+        }
+
+        visits.set(knots.back()[0], knots.back()[1]);
+
+        return straight;
+    }
+
+    void translate(const std::array<int, 2>& delta, std::size_t steps)
+    {
+        if (steps == 0)
+            return;
+
+        auto& tail = knots.back();
+        for (std::size_t s = 0; s < steps; ++s)
+        {
+            tail[0] += delta[0];
+            tail[1] += delta[1];
+            visits.set(tail[0], tail[1]);
+        }
+
+        for (std::size_t i = 0; i + 1 < knots.size(); ++i)
+        {
+            knots[i][0] += delta[0] * (int)steps;
+            knots[i][1] += delta[1] * (int)steps;
+        }
+    }
+
+    /* 0 is the head, the last one is the tail */
+    std::vector<std::array<int, 2>> knots;
+    TiledBitmap visits;
+};
+
+void benchmark(std::size_t length, std::size_t steps)
+{
+    std::mt19937 rng(2022);
+    std::uniform_int_distribution<int> dirs(0, 3);
+    std::uniform_int_distribution<std::size_t> lengths(1, 2000);
+
+    std::vector<Command> commands;
+    std::size_t total = 0;
+    while (total < steps)
+    {
+        commands.emplace_back();
+        commands.back().dir = static_cast<Command::Direction>(dirs(rng));
+        commands.back().steps = std::min(lengths(rng), steps - total);
+        total += commands.back().steps;
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    Rope rope(length);
+    rope.run(commands);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+    std::cout << length << " knots, " << total << " steps : " << rope.countVisitedSites() << " positions visited in " << elapsed.count() * 1000 << " ms" << std::endl;
+}
+
 int
 main(int argc, char **argv)
 {
     if (argc < 2)
     {
-        fprintf(stderr, "Usage: %s datafilename\n", argv[0]);
+        fprintf(stderr, "Usage: %s datafilename [bitmap]\n", argv[0]);
+        fprintf(stderr, "       %s bench [knots] [steps]\n", argv[0]);
         exit(-1);
     }
 
+    if (std::string(argv[1]) == "bench")
+    {
+        benchmark((argc > 2) ? std::stoul(argv[2]) : 1000, (argc > 3) ? std::stoul(argv[3]) : 10000000);
+        return 0;
+    }
+
     std::vector<Command> commands;
 
     try
@@ -360,6 +546,19 @@ main(int argc, char **argv)
         std::exit(-1);
     }
 
+    if ((argc > 2) && (std::string(argv[2]) == "bitmap"))
+    {
+        Rope shortRope(2);
+        shortRope.run(commands);
+        std::cout << "Short rope " << shortRope.countVisitedSites() << " positions visited" << std::endl;
+
+        Rope longRope(10);
+        longRope.run(commands);
+        std::cout << "Long rope " << longRope.countVisitedSites() << " positions visited" << std::endl;
+
+        return 0;
+    }
+
     Space<2> shortRope;
     shortRope.run(commands);
     std::cout << "Short rope " << shortRope.countVisitedSites() << " positions visited" << std::endl;
@@ -12,6 +12,9 @@
 #include <exception>
 #include <deque>
 #include <iomanip>
+#include <functional>
+#include <numeric>
+#include "monkeydef.h"
 
 constexpr bool do_debug{false};
 
@@ -81,13 +84,33 @@ main(int argc, char **argv)
 {
     if (argc < 2)
     {
-        fprintf(stderr, "Usage: %s datafilename\n", argv[0]);
+        fprintf(stderr, "Usage: %s test|input|datafilename parse\n", argv[0]);
         exit(-1);
     }
 
     std::vector<Monkey> monkeys;
 
-    if (std::string(argv[1]) == "test")
+    if ((argc > 2) && (std::string(argv[2]) == "parse"))
+    {
+        try
+        {
+            std::ifstream infile(argv[1]);
+
+            int id = 0;
+            for (auto& d : parseMonkeys(infile))
+            {
+                monkeys.emplace_back(id++, d.items,
+                    [d](const int64_t& old) { return d.apply(old); },
+                    [d](const int64_t& value) { return d.target(value); });
+            }
+        }
+        catch(std::exception& e)
+        {
+            std::cerr << "Reading data error: " << e.what() << std::endl;
+            std::exit(-1);
+        }
+    }
+    else if (std::string(argv[1]) == "test")
     {
         monkeys.emplace_back(0, std::vector<int64_t>({79, 98}), 
             [](const int64_t& old) { return old * 19; }, 
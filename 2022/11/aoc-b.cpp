@@ -12,7 +12,13 @@
 #include <exception>
 #include <deque>
 #include <iomanip>
+#include <future>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <numeric>
 #include <cmath>
+#include "monkeydef.h"
 
 constexpr bool do_debug{false};
 
@@ -70,15 +76,242 @@ private:
     int64_t limiter;
 };
 
+/* The product of two inspection counts can outgrow 64 bits over a billion rounds */
+std::string toString(unsigned __int128 v)
+{
+    std::string digits;
+    do
+    {
+        digits.push_back('0' + (int)(v % 10));
+        v /= 10;
+    } while (v > 0);
+
+    return std::string(digits.rbegin(), digits.rend());
+}
+
+/* Items never interact : an item's future only depends on the monkey holding it and its worry level modulo the
+ * product of all divisors.  So each item is followed on its own, round by round, until that state at the start of a
+ * round repeats.  Its inspections for any number of rounds then follow from the lead-in and one cycle.
+ */
+class ItemCycles
+{
+public:
+
+    ItemCycles(const std::vector<MonkeyDef>& a_defs) : defs(a_defs), limiter(1)
+    {
+        for (auto& d : defs)
+        {
+            limiter = std::lcm(limiter, d.divisor);
+        }
+    }
+
+    /* Items are handed out to a fixed pool of workers, one per hardware thread, each adding up its own totals */
+    std::vector<uint64_t> countInspections(uint64_t rounds) const
+    {
+        std::vector<State> starts;
+
+        for (std::size_t m = 0; m < defs.size(); ++m)
+        {
+            for (auto worry : defs[m].items)
+            {
+                starts.push_back(State{(int)m, worry % limiter});
+            }
+        }
+
+        std::size_t n_workers = std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()), starts.size());
+        std::atomic<std::size_t> next{0};
+
+        std::vector<std::future<std::vector<uint64_t>>> workers;
+        for (std::size_t w = 0; w < n_workers; ++w)
+        {
+            workers.emplace_back(std::async(std::launch::async, [this, &starts, &next, rounds]() {
+                std::vector<uint64_t> sub(defs.size(), 0);
+
+                for (std::size_t i = next++; i < starts.size(); i = next++)
+                {
+                    auto counts = countItem(starts[i], rounds);
+                    for (std::size_t m = 0; m < sub.size(); ++m)
+                    {
+                        sub[m] += counts[m];
+                    }
+                }
+
+                return sub;
+            }));
+        }
+
+        std::vector<uint64_t> total(defs.size(), 0);
+        for (auto& w : workers)
+        {
+            auto counts = w.get();
+            for (std::size_t m = 0; m < total.size(); ++m)
+            {
+                total[m] += counts[m];
+            }
+        }
+
+        return total;
+    }
+
+private:
+
+    struct State
+    {
+        int monkey;
+        int64_t worry;
+
+        bool operator==(const State& rhs) const
+        {
+            return (monkey == rhs.monkey) && (worry == rhs.worry);
+        }
+
+        bool operator!=(const State& rhs) const
+        {
+            return ! (*this == rhs);
+        }
+    };
+
+    /* One round for one item.  Monkeys take turns in order, so an item thrown to a later monkey is inspected again in
+     * the same round.
+     */
+    State round(State s, std::vector<uint64_t>* counts) const
+    {
+        while (true)
+        {
+            const MonkeyDef& d = defs[s.monkey];
+            if (counts)
+                (*counts)[s.monkey]++;
+
+            s.worry = d.apply(s.worry) % limiter;
+            int dst = d.target(s.worry);
+
+            bool next_round = (dst <= s.monkey);
+            s.monkey = dst;
+
+            if (next_round)
+                return s;
+        }
+    }
+
+    State run(State s, uint64_t rounds, std::vector<uint64_t>& counts) const
+    {
+        for (uint64_t r = 0; r < rounds; ++r)
+        {
+            s = round(s, &counts);
+        }
+
+        return s;
+    }
+
+    std::vector<uint64_t> countItem(State start, uint64_t rounds) const
+    {
+        /* Brent's cycle detection : lambda is the cycle length, mu the number of rounds before the cycle starts */
+        uint64_t power = 1;
+        uint64_t lambda = 1;
+        State tortoise = start;
+        State hare = round(start, nullptr);
+
+        while ((tortoise != hare) && (lambda <= rounds))
+        {
+            if (power == lambda)
+            {
+                tortoise = hare;
+                power *= 2;
+                lambda = 0;
+            }
+            hare = round(hare, nullptr);
+            lambda++;
+        }
+
+        std::vector<uint64_t> counts(defs.size(), 0);
+
+        if (tortoise != hare)
+        {
+            /* No cycle within the requested rounds, just play them */
+            run(start, rounds, counts);
+            return counts;
+        }
+
+        uint64_t mu = 0;
+        tortoise = start;
+        hare = start;
+        for (uint64_t i = 0; i < lambda; ++i)
+        {
+            hare = round(hare, nullptr);
+        }
+
+        while ((tortoise != hare) && (mu < rounds))
+        {
+            tortoise = round(tortoise, nullptr);
+            hare = round(hare, nullptr);
+            mu++;
+        }
+
+        if (rounds <= mu + lambda)
+        {
+            run(start, rounds, counts);
+            return counts;
+        }
+
+        State s = run(start, mu, counts);
+
+        std::vector<uint64_t> cycle(defs.size(), 0);
+        run(s, lambda, cycle);
+
+        uint64_t cycles = (rounds - mu) / lambda;
+        for (std::size_t m = 0; m < counts.size(); ++m)
+        {
+            counts[m] += cycles * cycle[m];
+        }
+
+        run(s, (rounds - mu) % lambda, counts);
+
+        return counts;
+    }
+
+    const std::vector<MonkeyDef>& defs;
+    int64_t limiter;
+};
+
 int
 main(int argc, char **argv)
 {
     if (argc < 2)
     {
-        fprintf(stderr, "Usage: %s datafilename\n", argv[0]);
+        fprintf(stderr, "Usage: %s test|input|datafilename parse|datafilename cycle [rounds]\n", argv[0]);
         exit(-1);
     }
 
+    std::string mode = (argc > 2) ? argv[2] : "";
+
+    if (mode == "cycle")
+    {
+        std::vector<MonkeyDef> defs;
+        try
+        {
+            std::ifstream infile(argv[1]);
+            defs = parseMonkeys(infile);
+        }
+        catch(std::exception& e)
+        {
+            std::cerr << "Reading data error: " << e.what() << std::endl;
+            std::exit(-1);
+        }
+
+        uint64_t rounds = (argc > 3) ? std::stoull(argv[3]) : 1000000000;
+
+        auto inspections = ItemCycles(defs).countInspections(rounds);
+        std::sort(inspections.begin(), inspections.end());
+
+        auto n1 = inspections.rbegin();
+        auto n2 = std::next(n1);
+
+        std::cout << "After round " << rounds << std::endl;
+        std::cout << "Monkey business level (" << *n1 << " * " << *n2 << ") = " << toString((unsigned __int128)*n1 * *n2) << std::endl;
+
+        return 0;
+    }
+
     std::vector<Monkey> monkeys;
 
     /* Looking at the test function of each monkey, each monkey performs a modulo test.
@@ -89,7 +322,35 @@ main(int argc, char **argv)
      * Eg we want to track the number so we can test for modulo 23 or module 19, then we 
      * can keep track of the value number % (23*19).
      */
-    if (std::string(argv[1]) == "test")
+    if (mode == "parse")
+    {
+        try
+        {
+            std::ifstream infile(argv[1]);
+            auto defs = parseMonkeys(infile);
+
+            int64_t limiter = 1;
+            for (auto& d : defs)
+            {
+                limiter = std::lcm(limiter, d.divisor);
+            }
+
+            int id = 0;
+            for (auto& d : defs)
+            {
+                monkeys.emplace_back(id++, d.items,
+                    [d](const int64_t& old) { return d.apply(old); },
+                    [d](const int64_t& value) { return d.target(value); },
+                    limiter);
+            }
+        }
+        catch(std::exception& e)
+        {
+            std::cerr << "Reading data error: " << e.what() << std::endl;
+            std::exit(-1);
+        }
+    }
+    else if (std::string(argv[1]) == "test")
     {
         const int64_t limiter = 23*19*13*17;
 
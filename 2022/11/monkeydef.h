@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/* One monkey from the input file : new = old + operand, old * operand or old * old, then thrown to if_true or
+ * if_false depending on divisibility by divisor.
+ */
+struct MonkeyDef
+{
+    enum Kind
+    {
+        ADD,
+        MUL,
+        SQUARE
+    };
+
+    Kind kind;
+    int64_t operand;
+    int64_t divisor;
+    int if_true;
+    int if_false;
+    std::vector<int64_t> items;
+
+    int64_t apply(int64_t old) const
+    {
+        switch (kind)
+        {
+        case ADD: return old + operand;
+        case MUL: return old * operand;
+        case SQUARE: return old * old;
+        }
+        return old;
+    }
+
+    int target(int64_t level) const
+    {
+        return ((level % divisor) == 0) ? if_true : if_false;
+    }
+};
+
+inline std::vector<MonkeyDef> parseMonkeys(std::istream& is)
+{
+    static const std::regex monkey_rule{"^Monkey ([0-9]+):\\s*$"};
+    static const std::regex items_rule{"^\\s*Starting items:\\s*([0-9, ]*)$"};
+    static const std::regex op_rule{"^\\s*Operation: new = old ([*+]) (old|[0-9]+)\\s*$"};
+    static const std::regex test_rule{"^\\s*Test: divisible by ([0-9]+)\\s*$"};
+    static const std::regex throw_rule{"^\\s*If (true|false): throw to monkey ([0-9]+)\\s*$"};
+
+    std::vector<MonkeyDef> defs;
+
+    std::string line;
+    while (std::getline(is, line))
+    {
+        std::smatch match;
+
+        if (line.empty())
+        {
+            continue;
+        }
+        else if (std::regex_match(line, match, monkey_rule))
+        {
+            if (std::stoul(match[1].str()) != defs.size())
+                throw std::invalid_argument("Monkeys out of order");
+
+            defs.emplace_back(MonkeyDef{MonkeyDef::ADD, 0, 0, -1, -1, {}});
+        }
+        else if (defs.empty())
+        {
+            throw std::invalid_argument("Data before first monkey");
+        }
+        else if (std::regex_match(line, match, items_rule))
+        {
+            std::string items = match[1].str();
+            std::size_t head = 0;
+            while (head < items.size())
+            {
+                std::size_t tail = items.find(',', head);
+                if (tail == std::string::npos)
+                    tail = items.size();
+
+                defs.back().items.push_back(std::stoll(items.substr(head, tail - head)));
+                head = tail + 1;
+            }
+        }
+        else if (std::regex_match(line, match, op_rule))
+        {
+            if (match[2].str() == "old")
+            {
+                if (match[1].str() != "*")
+                    throw std::invalid_argument("Unsupported operation : " + line);
+
+                defs.back().kind = MonkeyDef::SQUARE;
+            }
+            else
+            {
+                defs.back().kind = (match[1].str() == "*") ? MonkeyDef::MUL : MonkeyDef::ADD;
+                defs.back().operand = std::stoll(match[2].str());
+            }
+        }
+        else if (std::regex_match(line, match, test_rule))
+        {
+            defs.back().divisor = std::stoll(match[1].str());
+        }
+        else if (std::regex_match(line, match, throw_rule))
+        {
+            int target = std::stoi(match[2].str());
+            if (match[1].str() == "true")
+            {
+                defs.back().if_true = target;
+            }
+            else
+            {
+                defs.back().if_false = target;
+            }
+        }
+        else
+        {
+            throw std::invalid_argument("Syntax error : " + line);
+        }
+    }
+
+    for (auto& d : defs)
+    {
+        if ((d.divisor <= 0) || (d.if_true < 0) || (d.if_false < 0) || ((std::size_t)d.if_true >= defs.size()) || ((std::size_t)d.if_false >= defs.size()))
+            throw std::invalid_argument("Incomplete monkey definition");
+    }
+
+    return defs;
+}
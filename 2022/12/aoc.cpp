@@ -12,9 +12,195 @@
 #include <exception>
 #include <deque>
 #include <iomanip>
+#include <chrono>
+#include <random>
 
 constexpr bool do_debug{false};
 
+/* Breadth first distances from a set of source cells.  steps(c, visit) calls visit for every cell one step away
+ * from c.  Every cell is queued at most once, so a ring of cells entries never overflows.  Cells that are never
+ * reached keep the maximum value.
+ */
+template<typename Steps>
+std::vector<uint32_t> breadthFirst(std::size_t cells, const std::vector<uint32_t>& sources, Steps steps)
+{
+    constexpr uint32_t unreached = std::numeric_limits<uint32_t>::max();
+
+    std::vector<uint32_t> distances(cells, unreached);
+    std::vector<uint32_t> queue(cells);
+    std::size_t head = 0;
+    std::size_t tail = 0;
+
+    for (auto s : sources)
+    {
+        if (distances[s] == unreached)
+        {
+            distances[s] = 0;
+            queue[tail++ % cells] = s;
+        }
+    }
+
+    while (head != tail)
+    {
+        uint32_t c = queue[head++ % cells];
+        uint32_t next = distances[c] + 1;
+
+        steps(c, [&](uint32_t n) {
+            if (distances[n] == unreached)
+            {
+                distances[n] = next;
+                queue[tail++ % cells] = n;
+            }
+        });
+    }
+
+    return distances;
+}
+
+static std::size_t toDistance(uint32_t d)
+{
+    return (d == std::numeric_limits<uint32_t>::max()) ? std::numeric_limits<std::size_t>::max() : d;
+}
+
+/* Compact heightmap : the heights live in one contiguous buffer, neighbours are worked out from them on the fly */
+class Heightmap
+{
+public:
+
+    Heightmap() : width(0), start_index(0), end_index(0), has_start(false), has_end(false) {};
+
+    void addLine(const std::string& line)
+    {
+        if (width == 0)
+        {
+            width = line.size();
+        }
+        else if (width != line.size())
+        {
+            throw std::invalid_argument("Irregular grid sizing");
+        }
+
+        for (auto& c : line)
+        {
+            if (c == 'S')
+            {
+                start_index = heights.size();
+                has_start = true;
+                heights.push_back(0);
+            }
+            else if (c == 'E')
+            {
+                end_index = heights.size();
+                has_end = true;
+                heights.push_back('z' - 'a');
+            }
+            else
+            {
+                heights.push_back(c - 'a');
+            }
+        }
+    }
+
+    void finalize()
+    {
+        if (! has_start)
+            throw std::invalid_argument("No start point in data");
+
+        if (! has_end)
+            throw std::invalid_argument("No end point in data");
+    }
+
+    std::size_t cells() const { return heights.size(); }
+    uint32_t startCell() const { return start_index; }
+    uint32_t endCell() const { return end_index; }
+
+    std::vector<uint32_t> lowPoints() const
+    {
+        std::vector<uint32_t> low;
+
+        for (std::size_t i = 0; i < heights.size(); ++i)
+        {
+            if (heights[i] == 0)
+            {
+                low.push_back(i);
+            }
+        }
+
+        return low;
+    }
+
+    /* Cells reachable in one step from c : at most one higher */
+    template<typename F>
+    void forEachNeighbour(uint32_t c, F visit) const
+    {
+        forEachAdjacent(c, [&](uint32_t n) {
+            if (heights[n] <= heights[c] + 1)
+                visit(n);
+        });
+    }
+
+    /* Cells that can reach c in one step */
+    template<typename F>
+    void forEachPredecessor(uint32_t c, F visit) const
+    {
+        forEachAdjacent(c, [&](uint32_t p) {
+            if (heights[c] <= heights[p] + 1)
+                visit(p);
+        });
+    }
+
+    /* Label every cell with its distance to the end in one breadth first pass, walking the steps backwards */
+    void labelDistances()
+    {
+        distances = breadthFirst(heights.size(), {end_index}, [this](uint32_t c, auto visit) {
+            forEachPredecessor(c, visit);
+        });
+    }
+
+    std::size_t distanceFrom(std::size_t x, std::size_t y) const
+    {
+        return toDistance(distances[y * width + x]);
+    }
+
+    std::size_t distanceFromStart() const
+    {
+        return toDistance(distances[start_index]);
+    }
+
+    std::size_t shortestDistanceFromBottom() const
+    {
+        uint32_t shortest = std::numeric_limits<uint32_t>::max();
+
+        for (auto i : lowPoints())
+        {
+            shortest = std::min(shortest, distances[i]);
+        }
+
+        return toDistance(shortest);
+    }
+
+private:
+
+    template<typename F>
+    void forEachAdjacent(uint32_t c, F visit) const
+    {
+        std::size_t x = c % width;
+
+        if (c >= width) visit(c - width);
+        if (x + 1 < width) visit(c + 1);
+        if (c + width < heights.size()) visit(c + width);
+        if (x > 0) visit(c - 1);
+    }
+
+    std::vector<uint8_t> heights;
+    std::size_t width;
+    uint32_t start_index;
+    uint32_t end_index;
+    bool has_start;
+    bool has_end;
+    std::vector<uint32_t> distances;
+};
+
 class Map {
 
 public:
@@ -36,6 +222,7 @@ public:
         int height;
         std::size_t distance;
         bool visited;
+        uint32_t index;
     
         std::vector<Node*> neighbours;
 
@@ -85,6 +272,9 @@ public:
             {
                 row.emplace_back(std::make_unique<Node>(c));
             }
+
+            row.back()->index = nodes.size();
+            nodes.push_back(row.back().get());
         }
     }
 
@@ -192,6 +382,37 @@ public:
         return shortest_distance;
     }
 
+    /* Cells are numbered in reading order, so the node graph can be searched by the same templates as the
+     * flat heightmap
+     */
+    std::size_t cells() const { return nodes.size(); }
+    uint32_t startCell() const { return start->index; }
+    uint32_t endCell() const { return end->index; }
+
+    std::vector<uint32_t> lowPoints() const
+    {
+        std::vector<uint32_t> low;
+
+        for (auto n : nodes)
+        {
+            if (n->height == 0)
+            {
+                low.push_back(n->index);
+            }
+        }
+
+        return low;
+    }
+
+    template<typename F>
+    void forEachNeighbour(uint32_t c, F visit) const
+    {
+        for (auto n : nodes[c]->neighbours)
+        {
+            visit(n->index);
+        }
+    }
+
 private:
 
    std::size_t findShortestPath(Node *a_start)
@@ -228,17 +449,123 @@ private:
     std::vector<std::vector<std::unique_ptr<Node>>> grid;
     Node *start;
     Node *end;
+
+    std::vector<Node*> nodes;
 };
 
+/* Shortest climb from any of the sources to the end, on any grid representation */
+template<typename Grid>
+std::size_t climb(const Grid& grid, const std::vector<uint32_t>& sources)
+{
+    auto distances = breadthFirst(grid.cells(), sources, [&grid](uint32_t c, auto visit) {
+        grid.forEachNeighbour(c, visit);
+    });
+
+    return toDistance(distances[grid.endCell()]);
+}
+
+template<typename Grid>
+void benchmarkGrid(const char *name, const std::vector<std::string>& lines)
+{
+    auto begin = std::chrono::steady_clock::now();
+
+    Grid grid;
+    for (auto& l : lines)
+    {
+        grid.addLine(l);
+    }
+    grid.finalize();
+
+    std::chrono::duration<double> built = std::chrono::steady_clock::now() - begin;
+
+    begin = std::chrono::steady_clock::now();
+    std::size_t a = climb(grid, {grid.startCell()});
+    std::size_t b = climb(grid, grid.lowPoints());
+    std::chrono::duration<double> searched = std::chrono::steady_clock::now() - begin;
+
+    std::cout << std::setw(6) << name << " : build " << std::setw(10) << std::fixed << std::setprecision(1) << built.count() * 1000 << " ms, search " << std::setw(10) << searched.count() * 1000 << " ms (top " << a << ", trail " << b << ")" << std::endl;
+}
+
+/* Random size x size heightmap, searched by both representations */
+void benchmark(std::size_t size)
+{
+    std::mt19937 rng(2022);
+    std::uniform_int_distribution<int> noise(-1, 1);
+
+    /* A noisy hill with the top in the middle, so there is a long climb to find */
+    const int centre = size / 2;
+    std::vector<std::string> lines(size, std::string(size, 'a'));
+    for (std::size_t y = 0; y < size; ++y)
+    {
+        for (std::size_t x = 0; x < size; ++x)
+        {
+            int slope = 25 - (int)((std::abs((int)x - centre) + std::abs((int)y - centre)) * 26 / (size + 1));
+            lines[y][x] = 'a' + std::min(25, std::max(0, slope + noise(rng)));
+        }
+    }
+    lines[0][0] = 'S';
+    lines[centre][centre] = 'E';
+
+    benchmarkGrid<Heightmap>("flat", lines);
+    benchmarkGrid<Map>("nodes", lines);
+}
+
 int
 main(int argc, char **argv)
 {
     if (argc < 2)
     {
-        fprintf(stderr, "Usage: %s datafilename\n", argv[0]);
+        fprintf(stderr, "Usage: %s datafilename [bfs|flat]\n", argv[0]);
+        fprintf(stderr, "       %s bench [size]\n", argv[0]);
         exit(-1);
     }
 
+    if (std::string(argv[1]) == "bench")
+    {
+        benchmark((argc > 2) ? std::stoul(argv[2]) : 5000);
+        return 0;
+    }
+
+    std::string mode = (argc > 2) ? argv[2] : "";
+
+    if ((mode == "flat") || (mode == "bfs"))
+    {
+        Heightmap heightmap;
+
+        try
+        {
+            std::ifstream infile(argv[1]);
+
+            std::string line;
+            while (std::getline(infile, line))
+            {
+                heightmap.addLine(line);
+            }
+
+            heightmap.finalize();
+        }
+        catch(std::exception& e)
+        {
+            std::cerr << "Reading data error: " << e.what() << std::endl;
+            std::exit(-1);
+        }
+
+        if (mode == "bfs")
+        {
+            heightmap.labelDistances();
+
+            std::cout << "Shortest path to top " << heightmap.distanceFromStart() << std::endl;
+            std::cout << "Shortest hiking trail " << heightmap.shortestDistanceFromBottom() << std::endl;
+
+            return 0;
+        }
+
+        std::cout << "Shortest path to top " << climb(heightmap, {heightmap.startCell()}) << std::endl;
+        std::cout << "Shortest hiking trail " << climb(heightmap, heightmap.lowPoints()) << std::endl;
+
+        return 0;
+    }
+
     Map map;
 
     try
@@ -12,6 +12,14 @@
 #include <exception>
 #include <deque>
 #include <iomanip>
+#include <thread>
+#include <future>
+#include <cstring>
+#include <string_view>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 constexpr bool do_debug{false};
 
@@ -43,8 +51,156 @@ public:
     std::vector<std::unique_ptr<Item>> list;
 
     static std::unique_ptr<Item> parse(const std::string& line);
+
+    static Decision compare(std::string_view lhs, std::string_view rhs);
+};
+
+/* Cursor over a raw packet string.  A number that has to be compared against a list is promoted virtually : the
+ * opening bracket is taken as read and the matching closing bracket is produced right after the number.  Reading
+ * past the end of the packet gives '\0'.
+ */
+class PacketCursor
+{
+public:
+    PacketCursor(std::string_view a_s) : p(a_s.data()), end(a_s.data() + a_s.size()), pending(0), closing(0) {}
+
+    char peek() const
+    {
+        if (closing > 0)
+            return ']';
+
+        return (p < end) ? *p : '\0';
+    }
+
+    void advance()
+    {
+        if (closing > 0)
+        {
+            closing--;
+        }
+        else
+        {
+            p++;
+        }
+    }
+
+    int readNumber()
+    {
+        int v = 0;
+        while ((p < end) && (*p >= '0') && (*p <= '9'))
+        {
+            v = v * 10 + (*p - '0');
+            p++;
+        }
+
+        closing += pending;
+        pending = 0;
+
+        return v;
+    }
+
+    void promote()
+    {
+        pending++;
+    }
+
+private:
+    const char *p;
+    const char *end;
+    int pending;
+    int closing;
 };
 
+static bool isDigit(char c)
+{
+    return (c >= '0') && (c <= '9');
+}
+
+/* Compare two raw packets without building a tree.  The comparison stops at the first difference.  Packets that
+ * don't start with a list, end before it is closed or carry anything after it are rejected, like parse() does.
+ */
+Item::Decision Item::compare(std::string_view lhs, std::string_view rhs)
+{
+    if (lhs.empty() || (lhs[0] != '[') || rhs.empty() || (rhs[0] != '['))
+        throw std::invalid_argument("Unbalanced outer list");
+
+    PacketCursor l(lhs);
+    PacketCursor r(rhs);
+    int depth = 0;
+
+    while (true)
+    {
+        char a = l.peek();
+        char b = r.peek();
+
+        if ((a == '\0') || (b == '\0'))
+        {
+            throw std::invalid_argument("Unbalanced outer list");
+        }
+        else if (isDigit(a) && isDigit(b))
+        {
+            int va = l.readNumber();
+            int vb = r.readNumber();
+
+            if (va < vb) return IN_ORDER;
+            if (va > vb) return REVERSE_ORDER;
+        }
+        else if (a == b)
+        {
+            if (a == '[')
+            {
+                depth++;
+            }
+            else if (a == ']')
+            {
+                if (--depth == 0)
+                {
+                    l.advance();
+                    r.advance();
+
+                    if ((l.peek() != '\0') || (r.peek() != '\0'))
+                        throw std::invalid_argument("Unbalanced outer list");
+
+                    return NO_DECISION;
+                }
+            }
+            else if (a != ',')
+            {
+                throw std::invalid_argument("Malformed packet");
+            }
+
+            l.advance();
+            r.advance();
+        }
+        else if (a == ']')
+        {
+            /* left list runs out first */
+            return IN_ORDER;
+        }
+        else if (b == ']')
+        {
+            /* right list runs out first */
+            return REVERSE_ORDER;
+        }
+        else if ((a == '[') && isDigit(b))
+        {
+            depth++;
+            l.advance();
+            r.promote();
+        }
+        else if (isDigit(a) && (b == '['))
+        {
+            depth++;
+            l.promote();
+            r.advance();
+        }
+        else
+        {
+            throw std::invalid_argument("Malformed packet");
+        }
+    }
+}
+
 Item::Decision Item::compare(const std::unique_ptr<Item>& rhs)
 {
     if ((kind == VALUE) && (rhs->kind == VALUE))
@@ -216,15 +372,261 @@ std::ostream& operator<<(std::ostream& os, const std::unique_ptr<Item>& item)
     return os;
 }
 
+/* Read only memory map of a whole file */
+class MappedFile
+{
+public:
+    MappedFile(const char *filename) : data(nullptr), size(0)
+    {
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0)
+            throw std::invalid_argument("Can't open data file");
+
+        struct stat st;
+        if (fstat(fd, &st) < 0)
+        {
+            close(fd);
+            throw std::invalid_argument("Can't stat data file");
+        }
+
+        size = st.st_size;
+        if (size > 0)
+        {
+            void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED)
+            {
+                close(fd);
+                throw std::invalid_argument("Can't map data file");
+            }
+            data = static_cast<const char *>(p);
+        }
+
+        close(fd);
+    }
+
+    ~MappedFile()
+    {
+        if (data)
+            munmap(const_cast<char *>(data), size);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /* Every line that holds more than whitespace, without its line ending */
+    std::vector<std::string_view> lines() const
+    {
+        std::vector<std::string_view> ret;
+
+        const char *p = data;
+        const char *end = data + size;
+        while (p < end)
+        {
+            const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+            if (eol == nullptr)
+                eol = end;
+
+            std::string_view line(p, eol - p);
+            std::size_t last = line.find_last_not_of(" \t\r");
+            if (last != std::string_view::npos)
+                ret.push_back(line.substr(0, last + 1));
+
+            p = eol + 1;
+        }
+
+        return ret;
+    }
+
+private:
+    const char *data;
+    std::size_t size;
+};
+
+/* Run work(first, last) over [0, count) in chunks, one per hardware thread, and add up the results */
+template<typename Work>
+std::size_t parallelSum(std::size_t count, Work work)
+{
+    std::size_t n_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t chunk = (count + n_threads - 1) / n_threads;
+
+    std::vector<std::future<std::size_t>> results;
+    for (std::size_t first = 0; first < count; first += chunk)
+    {
+        results.emplace_back(std::async(std::launch::async, work, first, std::min(count, first + chunk)));
+    }
+
+    std::size_t sum = 0;
+    for (auto& r : results)
+    {
+        sum += r.get();
+    }
+
+    return sum;
+}
+
 int
 main(int argc, char **argv)
 {
     if (argc < 2)
     {
-        fprintf(stderr, "Usage: %s datafilename\n", argv[0]);
+        fprintf(stderr, "Usage: %s datafilename [stream|rank]\n", argv[0]);
         exit(-1);
     }
 
+    if ((argc > 2) && (std::string(argv[2]) == "rank"))
+    {
+        /* Packets are read straight from the mapped file, no sorting : a divider's position is one more than the
+         * number of packets that come before it.
+         */
+        std::size_t order_sum = 0;
+        std::size_t divider = 1;
+
+        try
+        {
+            MappedFile file(argv[1]);
+            auto packets = file.lines();
+
+            if (packets.size() & 1)
+                throw std::invalid_argument("Unpaired packet");
+
+            order_sum = parallelSum(packets.size() / 2, [&packets](std::size_t first, std::size_t last) {
+                std::size_t sum = 0;
+                for (std::size_t i = first; i < last; ++i)
+                {
+                    /* Comparing a packet with itself walks all of it, so malformed packets are caught here */
+                    Item::compare(packets[2 * i], packets[2 * i]);
+                    Item::compare(packets[2 * i + 1], packets[2 * i + 1]);
+
+                    auto order = Item::compare(packets[2 * i], packets[2 * i + 1]);
+
+                    if (order == Item::NO_DECISION)
+                        throw std::invalid_argument("no decision");
+
+                    if (order == Item::IN_ORDER)
+                        sum += i + 1;
+                }
+                return sum;
+            });
+
+            const std::array<std::string_view, 2> dividers{"[[2]]", "[[6]]"};
+
+            for (std::size_t d = 0; d < dividers.size(); ++d)
+            {
+                std::size_t before = parallelSum(packets.size(), [&packets, &dividers, d](std::size_t first, std::size_t last) {
+                    std::size_t count = 0;
+                    for (std::size_t i = first; i < last; ++i)
+                    {
+                        if (Item::compare(packets[i], dividers[d]) == Item::IN_ORDER)
+                            count++;
+                    }
+                    return count;
+                });
+
+                for (std::size_t o = 0; o < dividers.size(); ++o)
+                {
+                    if (Item::compare(dividers[o], dividers[d]) == Item::IN_ORDER)
+                        before++;
+                }
+
+                divider *= before + 1;
+            }
+        }
+        catch(std::exception& e)
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+            std::exit(-1);
+        }
+
+        std::cout << "Order sum " << order_sum << std::endl;
+        std::cout << "Divider sum " << divider << std::endl;
+
+        return 0;
+    }
+
+    if ((argc > 2) && (std::string(argv[2]) == "stream"))
+    {
+        /* Keep the packets as raw strings, the comparator walks them directly */
+        std::vector<std::string> packets;
+        try
+        {
+            std::ifstream infile(argv[1]);
+
+            std::string line;
+            while (std::getline(infile, line))
+            {
+                std::size_t last = line.find_last_not_of(" \t\r");
+                if (last != std::string::npos)
+                {
+                    packets.push_back(line.substr(0, last + 1));
+
+                    /* Comparing a packet with itself walks all of it, so unbalanced packets are caught here */
+                    Item::compare(packets.back(), packets.back());
+                }
+            }
+
+            if (packets.size() & 1)
+                throw std::invalid_argument("Unpaired packet");
+        }
+        catch(std::exception& e)
+        {
+            std::cerr << "Reading data error: " << e.what() << std::endl;
+            std::exit(-1);
+        }
+
+        std::size_t order_sum = 0;
+        for (std::size_t i = 0; i < packets.size(); i += 2)
+        {
+            auto order = Item::compare(packets[i], packets[i + 1]);
+
+            if (do_debug)
+            {
+                std::cout << Item::parse(packets[i]) << std::endl;
+                std::cout << Item::parse(packets[i + 1]) << std::endl;
+                std::cout << std::endl;
+            }
+
+            if (order == Item::NO_DECISION)
+            {
+                std::cout << "no decision" << std::endl;
+                std::exit(-1);
+            }
+
+            if (order == Item::IN_ORDER)
+            {
+                order_sum += 1 + i / 2;
+            }
+        }
+
+        std::cout << "Order sum " << order_sum << std::endl;
+
+        packets.push_back("[[2]]");
+        packets.push_back("[[6]]");
+        std::size_t first_divider = packets.size() - 2;
+
+        std::vector<std::size_t> order(packets.size());
+        for (std::size_t i = 0; i < order.size(); ++i)
+        {
+            order[i] = i;
+        }
+
+        std::sort(order.begin(), order.end(), [&packets](std::size_t a, std::size_t b) {
+            return Item::compare(packets[a], packets[b]) == Item::IN_ORDER;
+        });
+
+        std::size_t divider = 1;
+        for (std::size_t i = 0; i < order.size(); ++i)
+        {
+            if (order[i] >= first_divider)
+            {
+                divider *= i + 1;
+            }
+        }
+
+        std::cout << "Divider sum " << divider << std::endl;
+
+        return 0;
+    }
+
     std::vector<std::pair<std::unique_ptr<Item>, std::unique_ptr<Item>>> pairs;
     try
     {
@@ -12,6 +12,7 @@
 #include <exception>
 #include <deque>
 #include <iomanip>
+#include <cstdio>
 
 constexpr bool do_debug{false};
 
@@ -379,8 +380,89 @@ public:
         return false;
     }
 
+    /* Pour sand until it either falls into the abyss or blocks the source.  The path of the previous grain is kept
+     * on a stack: the next grain follows the same path up to where the last one settled, so it resumes from the last
+     * free position on that path.  Returns the number of settled grains.
+     */
+    std::size_t fill()
+    {
+        std::vector<Pixel> path;
+        std::size_t settled = 0;
+
+        if (isBlocked()) return 0;
+        path.emplace_back(500, 0);
+
+        while (! path.empty())
+        {
+            Pixel p = path.back();
+
+            if (p.y > lower_right.y)
+                /* Fell into the abyss, so will every grain after this one */
+                break;
+
+            int new_y = p.y + 1;
+
+            if (peek(p.x, new_y) == '.')
+            {
+                path.emplace_back(p.x, new_y);
+            }
+            else if (peek(p.x - 1, new_y) == '.')
+            {
+                path.emplace_back(p.x - 1, new_y);
+            }
+            else if (peek(p.x + 1, new_y) == '.')
+            {
+                path.emplace_back(p.x + 1, new_y);
+            }
+            else
+            {
+                at(p) = 'o';
+                settled++;
+                path.pop_back();
+            }
+        }
+
+        return settled;
+    }
+
+    /* With a floor every cell the sand can reach fills up, so count those row by row instead of dropping grains.  A
+     * cell is reachable when it is free and one of the three cells above it is reachable.
+     */
+    std::size_t countReachable() const
+    {
+        if (! withfloor)
+            throw std::logic_error("Counting reachable cells only works with a floor");
+
+        const int width = 1 + lower_right.x - upper_left.x;
+        std::vector<char> reach(width + 2, 0);
+        std::vector<char> next(width + 2, 0);
+
+        reach[1 + 500 - upper_left.x] = 1;
+        std::size_t count = 1;
+
+        for (int y = 1; y <= lower_right.y; ++y)
+        {
+            for (int i = 1; i <= width; ++i)
+            {
+                next[i] = (reach[i - 1] | reach[i] | reach[i + 1]) && (peek(upper_left.x + i - 1, y) != '#');
+                count += next[i];
+            }
+            std::swap(reach, next);
+        }
+
+        return count;
+    }
+
 private:
 
+    char peek(int x, int y) const
+    {
+        if ((x < upper_left.x) || (x > lower_right.x) || (y < upper_left.y) || (y > lower_right.y))
+            return '.';
+
+        return m_Grid[y - upper_left.y][x - upper_left.x];
+    }
+
     void addRock(const Rock& r)
     {
         for (auto &p : r)
@@ -419,15 +501,203 @@ std::ostream& operator<<(std::ostream& os, const Grid& g)
     return os;
 }
 
+/* Packed cave: one bit per cell for rock and one for sand, stored in 64 bit words per row.  The floor is not stored
+ * as a rock but implied by the last row, so the box only has to cover the sand cone instead of a widened rock.
+ */
+class BitGrid
+{
+public:
+
+    BitGrid(const std::vector<Rock>& rocks, bool a_withfloor) : withfloor(a_withfloor)
+    {
+        int min_x = 500;
+        int max_x = 500;
+        int max_y = 0;
+
+        for (auto& r : rocks)
+        {
+            for (auto& v : r.vertices)
+            {
+                min_x = std::min(min_x, v.x);
+                max_x = std::max(max_x, v.x);
+                max_y = std::max(max_y, v.y);
+            }
+        }
+
+        /* Lowest row a grain can reach: the floor lies right below it, without a floor a grain reaching it is lost */
+        bottom = max_y + 1;
+        if (withfloor)
+        {
+            min_x = std::min(min_x, 500 - bottom);
+            max_x = std::max(max_x, 500 + bottom);
+        }
+
+        /* One spare column on each side, so the three cell window never leaves the row */
+        x0 = min_x - 2;
+        width = 3 + max_x - x0;
+        stride = (width + 63) / 64 + 1;
+        rows = bottom + 1;
+
+        rock.assign(rows * stride, 0);
+        sand.assign(rows * stride, 0);
+
+        for (auto& r : rocks)
+        {
+            for (auto p : r)
+            {
+                set(rock, p.x, p.y);
+            }
+        }
+    }
+
+    std::size_t fill()
+    {
+        std::vector<Pixel> path;
+        std::size_t settled = 0;
+
+        path.emplace_back(500, 0);
+
+        while (! path.empty())
+        {
+            Pixel p = path.back();
+
+            unsigned below;
+
+            if (p.y < bottom)
+                below = window(p.x, p.y + 1);
+            else if (withfloor)
+                below = 7;
+            else
+                /* Falls past the lowest rock into the abyss, so will every grain after this one */
+                break;
+
+            if (! (below & 2))
+            {
+                path.emplace_back(p.x, p.y + 1);
+            }
+            else if (! (below & 1))
+            {
+                path.emplace_back(p.x - 1, p.y + 1);
+            }
+            else if (! (below & 4))
+            {
+                path.emplace_back(p.x + 1, p.y + 1);
+            }
+            else
+            {
+                set(sand, p.x, p.y);
+                settled++;
+                path.pop_back();
+            }
+        }
+
+        return settled;
+    }
+
+    /* Write the cave as a binary netpbm image in a single write: PBM shows every occupied cell, PGM tells rock and
+     * sand apart.
+     */
+    void dump(FILE *fp, bool gray) const
+    {
+        int height = rows + (withfloor ? 1 : 0);
+        std::string frame = std::string(gray ? "P5\n" : "P4\n") + std::to_string(width) + " " + std::to_string(height) + "\n";
+        if (gray)
+            frame += "255\n";
+
+        std::size_t header = frame.size();
+
+        if (gray)
+        {
+            frame.resize(header + width * height, (char)255);
+            char *out = &frame[header];
+
+            for (int y = 0; y < rows; ++y)
+            {
+                for (int i = 0; i < width; ++i)
+                {
+                    if (test(rock, y, i))
+                        out[i] = 0;
+                    else if (test(sand, y, i))
+                        out[i] = (char)160;
+                }
+                out += width;
+            }
+
+            if (withfloor)
+                std::fill(out, out + width, 0);
+        }
+        else
+        {
+            std::size_t line = (width + 7) / 8;
+            frame.resize(header + line * height, 0);
+            unsigned char *out = reinterpret_cast<unsigned char *>(&frame[header]);
+
+            for (int y = 0; y < rows; ++y)
+            {
+                for (int i = 0; i < width; ++i)
+                {
+                    if (test(rock, y, i) || test(sand, y, i))
+                        out[i / 8] |= 0x80 >> (i % 8);
+                }
+                out += line;
+            }
+
+            if (withfloor)
+                std::fill(out, out + line, 0xff);
+        }
+
+        fwrite(frame.data(), 1, frame.size(), fp);
+    }
+
+private:
+
+    void set(std::vector<uint64_t>& plane, int x, int y)
+    {
+        std::size_t i = x - x0;
+        plane[y * stride + i / 64] |= uint64_t(1) << (i % 64);
+    }
+
+    bool test(const std::vector<uint64_t>& plane, int y, int i) const
+    {
+        return (plane[y * stride + i / 64] >> (i % 64)) & 1;
+    }
+
+    /* Occupancy of (x-1, y), (x, y) and (x+1, y) as bits 0, 1 and 2 */
+    unsigned window(int x, int y) const
+    {
+        std::size_t i = x - x0 - 1;
+        std::size_t w = y * stride + i / 64;
+        unsigned b = i % 64;
+
+        uint64_t v = (rock[w] | sand[w]) >> b;
+        if (b > 61)
+            v |= (rock[w + 1] | sand[w + 1]) << (64 - b);
+
+        return v & 7;
+    }
+
+    bool withfloor;
+    int x0;
+    int width;
+    int rows;
+    int bottom;
+    std::size_t stride;
+
+    std::vector<uint64_t> rock;
+    std::vector<uint64_t> sand;
+};
+
 int
 main(int argc, char **argv)
 {
     if (argc < 2)
     {
-        fprintf(stderr, "Usage: %s datafilename\n", argv[0]);
+        fprintf(stderr, "Usage: %s datafilename [stack|cone|bits [dumpfile.pbm|dumpfile.pgm]]\n", argv[0]);
         exit(-1);
     }
 
+    std::string mode = (argc > 2) ? argv[2] : "";
+
     std::vector<Rock> rocks;
     try
     {
@@ -447,9 +717,48 @@ main(int argc, char **argv)
         std::exit(-1);
     }
 
+    if (mode == "bits")
+    {
+        BitGrid bits(rocks, false);
+        std::cout << "Floorless cave filled after " << bits.fill() << " iterations" << std::endl;
+
+        BitGrid bits2(rocks, true);
+        std::cout << "Floored cave filled after " << bits2.fill() << " iterations" << std::endl;
+
+        if (argc > 3)
+        {
+            std::string dumpname(argv[3]);
+            FILE *fp = fopen(argv[3], "wb");
+            if (! fp)
+            {
+                std::cerr << "Can't open " << dumpname << std::endl;
+                std::exit(-1);
+            }
+
+            bool gray = (dumpname.size() < 4) || (dumpname.substr(dumpname.size() - 4) != ".pbm");
+            bits2.dump(fp, gray);
+            fclose(fp);
+        }
+
+        return 0;
+    }
+
     Grid grid;
     grid.placeRocks(rocks);
 
+    if ((mode == "stack") || (mode == "cone"))
+    {
+        std::cout << "Floorless cave filled after " << grid.fill() << " iterations" << std::endl;
+
+        Grid grid2(true);
+        grid2.placeRocks(rocks);
+
+        std::size_t filled = (mode == "cone") ? grid2.countReachable() : grid2.fill();
+        std::cout << "Floored cave filled after " << filled << " iterations" << std::endl;
+
+        return 0;
+    }
+
     std::size_t i=0;
     while (grid.drop())
     {
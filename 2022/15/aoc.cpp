@@ -47,6 +47,10 @@ public:
         return ret;
     }
 
+    int getX() const { return x; }
+    int getY() const { return y; }
+    int getDistance() const { return distance; }
+
     int getBeaconX() const { return x + cb_x; }
     int getBeaconY() const { return y + cb_y; }
 
@@ -88,35 +92,186 @@ std::ostream& operator<<(std::ostream& os, const std::shared_ptr<Sensor>& s)
 
 void mergelist(std::vector<std::pair<int, int>>& list)
 {
-    /* Try to merge segments, first all sort them on lowest x */
-    std::sort(list.begin(), list.end(), [](const std::pair<int, int>& a, const std::pair<int, int>& b) {
-        return a.first < b.first;
-    });
+    /* Sort the segments on lowest x, then compact overlapping or touching ones in place */
+    std::sort(list.begin(), list.end());
+
+    if (list.empty())
+        return;
 
-    auto left = list.begin();
-    while (left != list.end())
+    std::size_t out = 0;
+    for (std::size_t i = 1; i < list.size(); ++i)
     {
-        auto right = std::next(left);
-        if (right != list.end())
+        if (list[out].second >= list[i].first - 1)
         {
-            /* Check if these 2 segments overlap, if so adjust left 
-             * so incorporates both
-             */
-            if (left->second >= right->first-1)
+            list[out].second = std::max(list[out].second, list[i].second);
+        }
+        else
+        {
+            list[++out] = list[i];
+        }
+    }
+
+    list.resize(out + 1);
+}
+
+struct Gap
+{
+    int y;
+    int x_from;
+    int x_to;
+};
+
+/* Row sweep for when the search area may hold more than one gap.  The rows are split in bands over a number of
+ * worker threads.  Each worker reuses one segment buffer for all its rows.  A row is scanned by jumping x past the
+ * end of every sorted segment that covers it, so only the free ranges are visited.
+ */
+std::vector<Gap> sweepGaps(const std::vector<std::shared_ptr<Sensor>>& sensors, int min_xy, int max_xy, unsigned n_threads)
+{
+    if (n_threads == 0)
+        n_threads = 1;
+
+    std::vector<std::vector<Gap>> found(n_threads);
+    std::vector<std::thread> workers;
+
+    int64_t rows = (int64_t)max_xy - min_xy + 1;
+
+    for (unsigned t = 0; t < n_threads; ++t)
+    {
+        int first = min_xy + (int)((rows * t) / n_threads);
+        int last = min_xy + (int)((rows * (t + 1)) / n_threads) - 1;
+
+        workers.emplace_back([&sensors, &result = found[t], first, last, min_xy, max_xy]() {
+            std::vector<std::pair<int, int>> segments;
+            segments.reserve(sensors.size());
+
+            for (int y = first; y <= last; ++y)
             {
-                left->second = std::max(right->second, left->second);
-                list.erase(right);
+                segments.clear();
+                for (auto& s : sensors)
+                {
+                    auto r = s->getNoSensorSpots(y);
+                    if (r.first)
+                    {
+                        segments.emplace_back(r.second);
+                    }
+                }
+
+                std::sort(segments.begin(), segments.end());
+
+                int64_t x = min_xy;
+                for (auto& seg : segments)
+                {
+                    if (x > max_xy)
+                        break;
+
+                    if (seg.first > x)
+                    {
+                        result.push_back(Gap{y, (int)x, std::min(seg.first - 1, max_xy)});
+                    }
+
+                    x = std::max(x, (int64_t)seg.second + 1);
+                }
+
+                if (x <= max_xy)
+                {
+                    result.push_back(Gap{y, (int)x, max_xy});
+                }
             }
-            else
+        });
+    }
+
+    for (auto& w : workers)
+    {
+        w.join();
+    }
+
+    /* Bands are in row order, so concatenating keeps the gaps sorted */
+    std::vector<Gap> gaps;
+    for (auto& f : found)
+    {
+        gaps.insert(gaps.end(), f.begin(), f.end());
+    }
+
+    return gaps;
+}
+
+/* Find the spots in [min_xy, max_xy]^2 no sensor covers without sweeping rows.  A lone uncovered spot lies just
+ * outside the diamond of the sensors around it.  Rotated to u = x + y and v = x - y, every diamond edge is a
+ * line of constant u or v, so the candidates are the crossings of those boundary lines, plus where they meet the
+ * edges of the search area.  Each candidate is checked against all sensors.
+ */
+std::vector<std::pair<int, int>> findGaps(const std::vector<std::shared_ptr<Sensor>>& sensors, int min_xy, int max_xy)
+{
+    std::vector<int64_t> us;
+    std::vector<int64_t> vs;
+
+    for (auto& s : sensors)
+    {
+        int64_t r = s->getDistance() + 1;
+        int64_t u = s->getX() + s->getY();
+        int64_t v = s->getX() - s->getY();
+
+        us.push_back(u - r);
+        us.push_back(u + r);
+        vs.push_back(v - r);
+        vs.push_back(v + r);
+    }
+
+    std::sort(us.begin(), us.end());
+    us.erase(std::unique(us.begin(), us.end()), us.end());
+    std::sort(vs.begin(), vs.end());
+    vs.erase(std::unique(vs.begin(), vs.end()), vs.end());
+
+    std::vector<std::pair<int64_t, int64_t>> candidates;
+
+    for (auto u : us)
+    {
+        for (auto v : vs)
+        {
+            if (((u + v) & 1) == 0)
             {
-                left = right;
+                candidates.emplace_back((u + v) / 2, (u - v) / 2);
             }
         }
-        else
+    }
+
+    for (int64_t edge : {(int64_t)min_xy, (int64_t)max_xy})
+    {
+        for (auto u : us)
         {
-            break;
+            candidates.emplace_back(edge, u - edge);
+            candidates.emplace_back(u - edge, edge);
+        }
+        for (auto v : vs)
+        {
+            candidates.emplace_back(edge, edge - v);
+            candidates.emplace_back(edge + v, edge);
+        }
+        candidates.emplace_back(min_xy, edge);
+        candidates.emplace_back(max_xy, edge);
+    }
+
+    std::vector<std::pair<int, int>> gaps;
+
+    for (auto& c : candidates)
+    {
+        if ((c.first < min_xy) || (c.first > max_xy) || (c.second < min_xy) || (c.second > max_xy))
+            continue;
+
+        bool open = std::all_of(sensors.begin(), sensors.end(), [&c](const std::shared_ptr<Sensor>& s) {
+            return s->beaconPossible(c.first, c.second);
+        });
+
+        if (open)
+        {
+            gaps.emplace_back(c.first, c.second);
         }
     }
+
+    std::sort(gaps.begin(), gaps.end());
+    gaps.erase(std::unique(gaps.begin(), gaps.end()), gaps.end());
+
+    return gaps;
 }
 
 int
@@ -124,7 +279,7 @@ main(int argc, char **argv)
 {
     if (argc < 4)
     {
-        std::cerr << "Usage : " << argv[0] << " datafilename testrow searchspace" << std::endl << std::endl;
+        std::cerr << "Usage : " << argv[0] <<  " datafilename testrow searchspace [geometric|threads [n]]" << std::endl << std::endl;
         std::cerr << "For test  : " << argv[0] << " test.dat 10 20" << std::endl;
         std::cerr << "For input : " << argv[0] << " input.dat 2000000 4000000" << std::endl;
 
@@ -219,50 +374,70 @@ main(int argc, char **argv)
 
     std::cout << "Searching for beacon spots in area [" << min_x << "," << max_x << "]" << std::endl;
 
-    for (int y = min_x; y <= max_x; ++y)
-    {
-        std::vector<std::pair<int, int>> blocked_segments;
+    std::string mode = (argc > 4) ? argv[4] : "";
 
-        for (auto& s: sensors)
+    if (mode == "geometric")
+    {
+        for (auto& g : findGaps(sensors, min_x, max_x))
         {
-            auto r = s->getNoSensorSpots(y);
+            int64_t freq = (((int64_t)g.first)*4000000) + (int64_t)g.second;
 
-            if (r.first)
+            std::cout << "     -> " << "Sensor at (" << g.first << ", " << g.second << ") : freq " << freq << std::endl;
+        }
+
+        return 0;
+    }
+
+    if (mode == "threads")
+    {
+        int n_threads = (argc > 5) ? std::stoi(argv[5]) : (int)std::thread::hardware_concurrency();
+        if (n_threads < 1)
+        {
+            if (argc > 5)
             {
-                blocked_segments.emplace_back(std::max(min_x, r.second.first), std::min(max_x, r.second.second));
+                std::cerr << "Thread count must be at least 1" << std::endl;
+                std::exit(-1);
             }
-        }
 
-        /* Try to merge segments, first all sort them on lowest x */
-        std::sort(blocked_segments.begin(), blocked_segments.end(), [](const std::pair<int, int>& a, const std::pair<int, int>& b) {
-            return a.first < b.first;
-        });
+            n_threads = 1;
+        }
 
-        auto left = blocked_segments.begin();
-        while (left != blocked_segments.end())
+        for (auto& g : sweepGaps(sensors, min_x, max_x, (unsigned)n_threads))
         {
-            auto right = std::next(left);
-            if (right != blocked_segments.end())
+            if (g.x_from == g.x_to)
             {
-                /* Check if these 2 segments overlap, if so adjust left 
-                 * so incorporates both
-                 */
-                if (left->second >= right->first-1)
-                {
-                    left->second = std::max(right->second, left->second);
-                    blocked_segments.erase(right);
-                }
-                else
-                {
-                    left = right;
-                }
+                int64_t freq = (((int64_t)g.x_from)*4000000) + (int64_t)g.y;
+
+                std::cout << "     -> " << "Sensor at (" << g.x_from << ", " << g.y << ") : freq " << freq << std::endl;
             }
             else
             {
-                break;
+                std::cout << "     -> " << "Free from (" << g.x_from << ", " << g.y << ") to (" << g.x_to << ", " << g.y << ")" << std::endl;
             }
         }
 
+        return 0;
+    }
+
+    std::vector<std::pair<int, int>> blocked_segments;
+    blocked_segments.reserve(sensors.size());
+
+    for (int y = min_x; y <= max_x; ++y)
+    {
+        blocked_segments.clear();
+
+        for (auto& s: sensors)
+        {
+            auto r = s->getNoSensorSpots(y);
+
+            if (r.first)
+            {
+                blocked_segments.emplace_back(std::max(min_x, r.second.first), std::min(max_x, r.second.second));
+            }
+        }
+
+        mergelist(blocked_segments);
+
         if (blocked_segments.empty())
         {
             std::cerr << "Empty line ?" << std::endl;
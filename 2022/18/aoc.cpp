@@ -15,6 +15,9 @@
 #include <thread>
 #include <atomic>
 #include <list>
+#include <future>
+#include <map>
+#include <numeric>
 
 template<std::size_t N, typename T>
 std::array<T, N> operator+(const std::array<T, N>& lhs, const std::array<T, N>& rhs)
@@ -530,18 +533,361 @@ private:
     Extents<N, T> extents;
 };
 
+/* Dense bit-voxel version of the droplet.  The bounding box, padded by one layer of air on every side, is stored as
+ * rows of bits along the first axis.  Exterior air is found with a single BFS over rows, seeded from the padding,
+ * where each row is filled at word level.  Surfaces are counted as transitions between neighbouring voxels: XOR of
+ * a row with itself shifted by one along the first axis, XOR of neighbouring rows along the other axes.
+ */
+template<std::size_t N, typename T>
+class VoxelGrid
+{
+public:
+    VoxelGrid(const std::vector<std::array<T, N>>& coords)
+    {
+        for (auto& c : coords)
+        {
+            extents.update(c);
+        }
+
+        std::size_t n_rows = 1;
+        for (std::size_t dim = 0; dim < N; ++dim)
+        {
+            dims[dim] = coords.empty() ? 2 : std::size_t(extents.getMax()[dim] - extents.getMin()[dim]) + 3;
+            if (dim > 0)
+            {
+                strides[dim] = n_rows;
+                n_rows *= dims[dim];
+            }
+        }
+
+        words = (dims[0] + 63) / 64;
+        rows = n_rows;
+
+        solid.assign(rows * words, 0);
+        for (auto& c : coords)
+        {
+            std::size_t x = c[0] - extents.getMin()[0] + 1;
+            solid[row(c) * words + x / 64] |= uint64_t(1) << (x % 64);
+        }
+    }
+
+    std::size_t calculateCovered() const
+    {
+        return transitions(solid);
+    }
+
+    std::size_t calculatePocketed() const
+    {
+        std::vector<uint64_t> exterior = floodExterior();
+
+        /* Everything that isn't exterior air: the droplet with its pockets filled */
+        std::vector<uint64_t> filled(rows * words);
+        for (std::size_t r = 0; r < rows; ++r)
+        {
+            for (std::size_t w = 0; w < words; ++w)
+            {
+                filled[r * words + w] = ~exterior[r * words + w] & wordMask(w);
+            }
+        }
+
+        return transitions(filled);
+    }
+
+private:
+
+    std::size_t row(const std::array<T, N>& c) const
+    {
+        std::size_t ret = 0;
+        for (std::size_t dim = 1; dim < N; ++dim)
+        {
+            ret += std::size_t(c[dim] - extents.getMin()[dim] + 1) * strides[dim];
+        }
+        return ret;
+    }
+
+    uint64_t wordMask(std::size_t w) const
+    {
+        if ((w + 1 < words) || ((dims[0] % 64) == 0))
+            return ~uint64_t(0);
+
+        return (uint64_t(1) << (dims[0] % 64)) - 1;
+    }
+
+    std::size_t transitions(const std::vector<uint64_t>& bits) const
+    {
+        std::size_t ret = 0;
+
+        for (std::size_t r = 0; r < rows; ++r)
+        {
+            const uint64_t* b = &bits[r * words];
+            for (std::size_t w = 0; w < words; ++w)
+            {
+                uint64_t shifted = (b[w] << 1) | ((w > 0) ? (b[w - 1] >> 63) : 0);
+                ret += __builtin_popcountll(b[w] ^ shifted);
+            }
+        }
+
+        for (std::size_t dim = 1; dim < N; ++dim)
+        {
+            for (std::size_t r = 0; r < rows; ++r)
+            {
+                if (((r / strides[dim]) % dims[dim]) + 1 >= dims[dim])
+                    continue;
+
+                const uint64_t* a = &bits[r * words];
+                const uint64_t* b = &bits[(r + strides[dim]) * words];
+                for (std::size_t w = 0; w < words; ++w)
+                {
+                    ret += __builtin_popcountll(a[w] ^ b[w]);
+                }
+            }
+        }
+
+        return ret;
+    }
+
+    /* Occluded fills, spread x through the free bits g towards higher resp. lower bit positions */
+    static uint64_t fillUp(uint64_t x, uint64_t g)
+    {
+        x &= g;
+        x |= g & (x << 1);  g &= (g << 1);
+        x |= g & (x << 2);  g &= (g << 2);
+        x |= g & (x << 4);  g &= (g << 4);
+        x |= g & (x << 8);  g &= (g << 8);
+        x |= g & (x << 16); g &= (g << 16);
+        x |= g & (x << 32);
+        return x;
+    }
+
+    static uint64_t fillDown(uint64_t x, uint64_t g)
+    {
+        x &= g;
+        x |= g & (x >> 1);  g &= (g >> 1);
+        x |= g & (x >> 2);  g &= (g >> 2);
+        x |= g & (x >> 4);  g &= (g >> 4);
+        x |= g & (x >> 8);  g &= (g >> 8);
+        x |= g & (x >> 16); g &= (g >> 16);
+        x |= g & (x >> 32);
+        return x;
+    }
+
+    /* Grow the seeds in a row over the free voxels, one pass up and one pass down covers every run */
+    void fillRow(uint64_t* x, const uint64_t* s) const
+    {
+        for (std::size_t w = 0; w < words; ++w)
+        {
+            uint64_t free = ~s[w] & wordMask(w);
+            uint64_t carry = ((w > 0) && (x[w - 1] >> 63)) ? 1 : 0;
+            x[w] = fillUp(x[w] | carry, free);
+        }
+
+        for (std::size_t w = words; w-- > 0;)
+        {
+            uint64_t free = ~s[w] & wordMask(w);
+            uint64_t carry = ((w + 1 < words) && (x[w + 1] & 1)) ? (uint64_t(1) << 63) : 0;
+            x[w] = fillDown(x[w] | carry, free);
+        }
+    }
+
+    std::vector<uint64_t> floodExterior() const
+    {
+        std::vector<uint64_t> exterior(rows * words, 0);
+        std::vector<bool> queued(rows, true);
+        std::deque<std::size_t> todo;
+
+        /* Every row starts and ends in the padding, which is exterior air */
+        for (std::size_t r = 0; r < rows; ++r)
+        {
+            exterior[r * words] |= 1;
+            exterior[r * words + (dims[0] - 1) / 64] |= uint64_t(1) << ((dims[0] - 1) % 64);
+            todo.push_back(r);
+        }
+
+        while (! todo.empty())
+        {
+            std::size_t r = todo.front();
+            todo.pop_front();
+            queued[r] = false;
+
+            uint64_t* x = &exterior[r * words];
+            fillRow(x, &solid[r * words]);
+
+            for (std::size_t dim = 1; dim < N; ++dim)
+            {
+                std::size_t coord = (r / strides[dim]) % dims[dim];
+
+                for (int side = 0; side < 2; ++side)
+                {
+                    if ((side == 0) && (coord == 0)) continue;
+                    if ((side == 1) && (coord + 1 >= dims[dim])) continue;
+
+                    std::size_t n = (side == 0) ? r - strides[dim] : r + strides[dim];
+                    uint64_t* y = &exterior[n * words];
+                    const uint64_t* ns = &solid[n * words];
+
+                    bool grown = false;
+                    for (std::size_t w = 0; w < words; ++w)
+                    {
+                        uint64_t add = x[w] & ~ns[w] & ~y[w];
+                        if (add)
+                        {
+                            y[w] |= add;
+                            grown = true;
+                        }
+                    }
+
+                    if (grown && ! queued[n])
+                    {
+                        queued[n] = true;
+                        todo.push_back(n);
+                    }
+                }
+            }
+        }
+
+        return exterior;
+    }
+
+    Extents<N, T> extents;
+    std::array<std::size_t, N> dims;
+    std::array<std::size_t, N> strides;
+    std::size_t words;
+    std::size_t rows;
+    std::vector<uint64_t> solid;
+};
+
+/* Open sides by sorting instead of neighbour lookups.  For every axis the coordinates are sorted with that axis as
+ * the least significant key, so cubes touching along it end up next to each other and a linear scan counts the shared
+ * faces.  Each axis runs on its own thread and only sorts a 32-bit index array into the shared coordinates.
+ */
+template<std::size_t N, typename T>
+std::size_t countSidesSorted(const std::vector<std::array<T, N>>& coords)
+{
+    if (coords.size() > std::numeric_limits<uint32_t>::max())
+        throw std::length_error("Too many cubes");
+
+    std::array<std::future<std::pair<std::size_t, std::size_t>>, N> axes;
+
+    for (std::size_t axis = 0; axis < N; ++axis)
+    {
+        axes[axis] = std::async(std::launch::async, [&coords, axis]() {
+            std::vector<uint32_t> order(coords.size());
+            std::iota(order.begin(), order.end(), 0);
+
+            auto key = [&coords, axis](uint32_t i) {
+                std::array<T, N> k(coords[i]);
+                std::swap(k[axis], k[N - 1]);
+                return k;
+            };
+
+            std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+                return key(a) < key(b);
+            });
+
+            /* Returns (unique cubes, shared faces along this axis) */
+            std::size_t unique = order.empty() ? 0 : 1;
+            std::size_t shared = 0;
+
+            for (std::size_t i = 1; i < order.size(); ++i)
+            {
+                auto a = key(order[i - 1]);
+                auto b = key(order[i]);
+
+                if (a == b)
+                    continue;
+
+                unique++;
+                a[N - 1] += 1;
+                if (a == b)
+                    shared++;
+            }
+
+            return std::make_pair(unique, shared);
+        });
+    }
+
+    std::size_t cubes = 0;
+    std::size_t shared = 0;
+    for (auto& a : axes)
+    {
+        auto r = a.get();
+        cubes = r.first;
+        shared += r.second;
+    }
+
+    return 2 * N * cubes - 2 * shared;
+}
+
+/* Plain "x,y,z" lines, without going through a regex for every line */
+template<std::size_t N, typename T>
+std::vector<std::array<T, N>> readCoords(std::istream& is)
+{
+    std::vector<std::array<T, N>> ret;
+
+    std::string line;
+    while (std::getline(is, line))
+    {
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+
+        std::array<T, N> c;
+        const char* p = line.c_str();
+        for (std::size_t dim = 0; dim < N; ++dim)
+        {
+            char* end;
+            c[dim] = std::strtol(p, &end, 10);
+            if (end == p)
+                throw std::invalid_argument("Syntax error");
+
+            p = end;
+            if ((dim + 1 < N) && (*p++ != ','))
+                throw std::invalid_argument("Syntax error");
+        }
+
+        while ((*p == ' ') || (*p == '\t') || (*p == '\r'))
+            p++;
+        if (*p != '\0')
+            throw std::invalid_argument("Trailing characters after coordinates");
+
+        ret.push_back(c);
+    }
+
+    return ret;
+}
 
 int
 main(int argc, char **argv)
 {
     if (argc < 2)
     {
-        std::cerr << "Usage : " << argv[0] << " datafilename " << std::endl << std::endl;
+        std::cerr << "Usage : " << argv[0] << " datafilename [voxel|sorted]" << std::endl << std::endl;
 
         exit(-1);
     }
 
+    if ((argc > 2) && (std::string(argv[2]) == "sorted"))
+    {
+        std::vector<std::array<int, 3>> coords;
+        try
+        {
+            std::ifstream infile(argv[1]);
+            coords = readCoords<3, int>(infile);
+        }
+        catch(std::exception& e)
+        {
+            std::cerr << "Reading data error: " << e.what() << std::endl;
+            std::exit(-1);
+        }
+
+        std::cout << countSidesSorted(coords) << " Uncovered cube sides" << std::endl;
+
+        return 0;
+    }
+
+    bool with_voxel = (argc > 2) && (std::string(argv[2]) == "voxel");
+
     Grid<3, int> grid;
+    std::vector<std::array<int, 3>> coords;
     try
     {
         std::ifstream infile(argv[1]);
@@ -554,7 +900,16 @@ main(int argc, char **argv)
             std::smatch match;
             if (std::regex_match(line, match, matchrule))
             {
-                grid.addCube({std::stoi(match[1].str()),std::stoi(match[2].str()),std::stoi(match[3].str())});
+                std::array<int, 3> c{std::stoi(match[1].str()),std::stoi(match[2].str()),std::stoi(match[3].str())};
+
+                if (with_voxel)
+                {
+                    coords.push_back(c);
+                }
+                else
+                {
+                    grid.addCube(c);
+                }
             }
             else
             {
@@ -568,6 +923,16 @@ main(int argc, char **argv)
         std::exit(-1);
     }
 
+    if (with_voxel)
+    {
+        VoxelGrid<3, int> voxels(coords);
+
+        std::cout << voxels.calculateCovered() << " Uncovered cube sides" << std::endl;
+        std::cout << voxels.calculatePocketed() << " Uncovered cube exterior surface" << std::endl;
+
+        return 0;
+    }
+
     std::cout << grid.calculateCovered() << " Uncovered cube sides" << std::endl;
     std::cout << grid.calculatePocketed() << " Uncovered cube exterior surface" << std::endl;
 
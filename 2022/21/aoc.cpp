@@ -17,6 +17,14 @@
 #include <list>
 #include <future>
 #include <functional>
+#include <chrono>
+#include <queue>
+#include <random>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <string_view>
+#include <unordered_map>
 
 class Node
 {
@@ -438,17 +446,436 @@ private:
 const std::regex Work::operation_rule{"^\\s*([a-z]{4})\\s*:\\s*([a-z]{4})\\s*([+-/*]{1})\\s*([a-z]{4})\\s*$"};
 const std::regex Work::value_rule{"^\\s*([a-z]{4})\\s*:\\s*([0-9]+)\\s*$"};
 
+/* Same monkeys, compiled into a dense struct-of-arrays DAG.  Names get a dense index as they are seen, the graph is
+ * ordered once with Kahn's algorithm and then evaluated in a single sweep.  Names don't need to be 4 characters.
+ */
+class MonkeyGraph
+{
+public:
+    static constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+
+    void addMonkey(std::string_view line)
+    {
+        auto colon = line.find(':');
+        if (colon == std::string_view::npos)
+            throw std::invalid_argument("Can't parse monkey " + std::string(line));
+
+        uint32_t n = lookup(trim(line.substr(0, colon)));
+        if (op[n] != 0)
+            throw std::invalid_argument("Monkey defined twice " + std::string(line));
+
+        std::string_view expr = trim(line.substr(colon + 1));
+        auto split = expr.find_first_of("+-*/");
+
+        if (split == std::string_view::npos)
+        {
+            op[n] = '=';
+            value[n] = std::stoll(std::string(expr));
+        }
+        else
+        {
+            op[n] = expr[split];
+            lhs[n] = lookup(trim(expr.substr(0, split)));
+            rhs[n] = lookup(trim(expr.substr(split + 1)));
+        }
+    }
+
+    /* Topological order with Kahn's algorithm, operands always come before the monkeys using them */
+    void build()
+    {
+        const uint32_t size = op.size();
+
+        std::vector<uint32_t> pending(size, 0);
+        first_user.assign(size + 1, 0);
+
+        for (uint32_t n = 0; n < size; ++n)
+        {
+            if (op[n] == 0)
+                throw std::invalid_argument("Monkey " + names[n] + " is never defined");
+
+            if (op[n] != '=')
+            {
+                pending[n] = 2;
+                first_user[lhs[n] + 1]++;
+                first_user[rhs[n] + 1]++;
+            }
+        }
+
+        std::partial_sum(first_user.begin(), first_user.end(), first_user.begin());
+        users.resize(first_user.back());
+
+        {
+            std::vector<uint32_t> fill(first_user.begin(), first_user.end() - 1);
+            for (uint32_t n = 0; n < size; ++n)
+            {
+                if (op[n] != '=')
+                {
+                    users[fill[lhs[n]]++] = n;
+                    users[fill[rhs[n]]++] = n;
+                }
+            }
+        }
+
+        order.clear();
+        order.reserve(size);
+        for (uint32_t n = 0; n < size; ++n)
+        {
+            if (pending[n] == 0) order.push_back(n);
+        }
+
+        for (std::size_t i = 0; i < order.size(); ++i)
+        {
+            uint32_t n = order[i];
+            for (uint32_t u = first_user[n]; u < first_user[n + 1]; ++u)
+            {
+                if (--pending[users[u]] == 0) order.push_back(users[u]);
+            }
+        }
+
+        if (order.size() != size)
+            throw std::invalid_argument("Monkeys depend on each other in a loop");
+
+        rank.resize(size);
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            rank[order[i]] = i;
+        }
+
+        queued.assign(size, false);
+        evaluated = false;
+
+        root = find("root");
+        human = find("humn");
+
+        if (root == none)
+            throw std::invalid_argument("No root monkey");
+    }
+
+    void solve()
+    {
+        for (auto n : order)
+        {
+            value[n] = compute(n);
+        }
+
+        evaluated = true;
+    }
+
+    /* Change the number a monkey yells.  Once solved, only the monkeys depending on it are recomputed, in
+     * topological order, and propagation stops wherever a result doesn't change.
+     */
+    void update(const std::string& name, int64_t new_value)
+    {
+        set(name, new_value);
+        propagate();
+    }
+
+    /* Same as update, but monkeys shared by several changes are only recomputed once */
+    void update(const std::vector<std::pair<std::string, int64_t>>& changes)
+    {
+        for (auto& c : changes)
+        {
+            set(c.first, c.second);
+        }
+        propagate();
+    }
+
+    int64_t getRootNumber() const
+    {
+        return value[root];
+    }
+
+    /* Mark the monkeys depending on humn in one sweep, then walk that single path down from root inverting each
+     * operation.  Root itself acts as an equality test.
+     */
+    int64_t getHumanNumber() const
+    {
+        if ((human == none) || (op[root] == '='))
+            throw std::runtime_error("Can't find human value in path which doesn't lead to human");
+
+        std::vector<bool> on_path(op.size(), false);
+        for (auto n : order)
+        {
+            on_path[n] = (n == human) || ((op[n] != '=') && (on_path[lhs[n]] || on_path[rhs[n]]));
+        }
+
+        if (on_path[lhs[root]] == on_path[rhs[root]])
+            throw std::runtime_error("Human must be on exactly one side of root");
+
+        uint32_t n = on_path[lhs[root]] ? lhs[root] : rhs[root];
+        int64_t target = on_path[lhs[root]] ? value[rhs[root]] : value[lhs[root]];
+
+        while (n != human)
+        {
+            int64_t a = value[lhs[n]];
+            int64_t b = value[rhs[n]];
+
+            if (on_path[lhs[n]] && on_path[rhs[n]])
+                throw std::runtime_error("Human appears on both sides of " + names[n]);
+
+            if (on_path[lhs[n]])
+            {
+                switch (op[n])
+                {
+                case '+': target = target - b; break;
+                case '-': target = target + b; break;
+                case '*': target = target / b; break;
+                case '/': target = target * b; break;
+                }
+                n = lhs[n];
+            }
+            else
+            {
+                switch (op[n])
+                {
+                case '+': target = target - a; break;
+                case '-': target = a - target; break;
+                case '*': target = target / a; break;
+                case '/': target = a / target; break;
+                }
+                n = rhs[n];
+            }
+        }
+
+        return target;
+    }
+
+    std::size_t size() const
+    {
+        return op.size();
+    }
+
+private:
+
+    static std::string_view trim(std::string_view s)
+    {
+        auto b = s.find_first_not_of(" \t");
+        if (b == std::string_view::npos) return {};
+        auto e = s.find_last_not_of(" \t");
+        return s.substr(b, e - b + 1);
+    }
+
+    void set(const std::string& name, int64_t new_value)
+    {
+        uint32_t n = find(name);
+        if (n == none)
+            throw std::invalid_argument("Unknown monkey " + name);
+        if (op[n] != '=')
+            throw std::invalid_argument("Monkey " + name + " doesn't yell a number");
+
+        if (value[n] == new_value)
+            return;
+
+        value[n] = new_value;
+        if (evaluated)
+        {
+            enqueueUsers(n);
+        }
+    }
+
+    void enqueueUsers(uint32_t n)
+    {
+        for (uint32_t u = first_user[n]; u < first_user[n + 1]; ++u)
+        {
+            uint32_t user = users[u];
+            if (! queued[user])
+            {
+                queued[user] = true;
+                dirty.push(rank[user]);
+            }
+        }
+    }
+
+    /* Monkeys come off the queue by topological rank, so all their operands are up to date by then */
+    void propagate()
+    {
+        while (! dirty.empty())
+        {
+            uint32_t n = order[dirty.top()];
+            dirty.pop();
+            queued[n] = false;
+
+            int64_t v = compute(n);
+            if (v != value[n])
+            {
+                value[n] = v;
+                enqueueUsers(n);
+            }
+        }
+    }
+
+    uint32_t find(const std::string& name) const
+    {
+        auto i = index.find(name);
+        return (i == index.end()) ? none : i->second;
+    }
+
+    uint32_t lookup(std::string_view name)
+    {
+        auto [i, inserted] = index.emplace(std::string(name), op.size());
+        if (inserted)
+        {
+            names.emplace_back(name);
+            op.push_back(0);
+            lhs.push_back(none);
+            rhs.push_back(none);
+            value.push_back(0);
+        }
+        return i->second;
+    }
+
+    int64_t compute(uint32_t n) const
+    {
+        switch (op[n])
+        {
+        case '+': return value[lhs[n]] + value[rhs[n]];
+        case '-': return value[lhs[n]] - value[rhs[n]];
+        case '*': return value[lhs[n]] * value[rhs[n]];
+        case '/': return value[lhs[n]] / value[rhs[n]];
+        default:  return value[n];
+        }
+    }
+
+    std::unordered_map<std::string, uint32_t> index;
+    std::vector<std::string> names;
+
+    std::vector<char> op;
+    std::vector<uint32_t> lhs;
+    std::vector<uint32_t> rhs;
+    std::vector<int64_t> value;
+
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> rank;
+    std::vector<uint32_t> first_user;
+    std::vector<uint32_t> users;
+    uint32_t root = none;
+    uint32_t human = none;
+
+    bool evaluated = false;
+    std::vector<bool> queued;
+    std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> dirty;
+};
+
+/* Build a balanced tree with the given number of leaves and time random leaf updates, one by one and in batches.
+ * Every round is checked against a full re-evaluation.
+ */
+void benchmark(std::size_t leaves, std::size_t updates)
+{
+    /* With a single leaf there is no operation left to become root */
+    if (leaves < 2)
+        throw std::invalid_argument("Benchmark needs at least 2 leaves");
+
+    std::mt19937 rng(2022);
+    std::uniform_int_distribution<int64_t> numbers(1, 1000);
+
+    MonkeyGraph graph;
+    std::vector<std::string> level;
+
+    for (std::size_t i = 0; i < leaves; ++i)
+    {
+        level.push_back("leaf" + std::to_string(i));
+        graph.addMonkey(level.back() + ": " + std::to_string(numbers(rng)));
+    }
+    std::vector<std::string> leaf_names(level);
+
+    std::size_t counter = 0;
+    while (level.size() > 1)
+    {
+        std::vector<std::string> up;
+        for (std::size_t i = 0; i + 1 < level.size(); i += 2)
+        {
+            std::string name = (level.size() == 2) ? "root" : "node" + std::to_string(counter++);
+            graph.addMonkey(name + ": " + level[i] + ((rng() & 1) ? " + " : " - ") + level[i + 1]);
+            up.push_back(name);
+        }
+        if (level.size() & 1)
+        {
+            up.push_back(level.back());
+        }
+        std::swap(level, up);
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    graph.build();
+    graph.solve();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+    std::cout << graph.size() << " monkeys, build and solve " << elapsed.count() * 1000 << " ms" << std::endl;
+
+    auto check = [&]() {
+        int64_t incremental = graph.getRootNumber();
+        graph.solve();
+        if (graph.getRootNumber() != incremental)
+            throw std::logic_error("Incremental evaluation differs from full evaluation");
+    };
+
+    std::uniform_int_distribution<std::size_t> pick(0, leaf_names.size() - 1);
+
+    begin = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < updates; ++i)
+    {
+        graph.update(leaf_names[pick(rng)], numbers(rng));
+    }
+    elapsed = std::chrono::steady_clock::now() - begin;
+    check();
+
+    std::cout << "Single updates : " << std::fixed << std::setprecision(0) << updates / elapsed.count() << " per second" << std::endl;
+
+    const std::size_t batch_size = 100;
+    std::vector<std::pair<std::string, int64_t>> batch;
+
+    begin = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < updates; i += batch_size)
+    {
+        batch.clear();
+        for (std::size_t j = 0; j < std::min(batch_size, updates - i); ++j)
+        {
+            batch.emplace_back(leaf_names[pick(rng)], numbers(rng));
+        }
+        graph.update(batch);
+    }
+    elapsed = std::chrono::steady_clock::now() - begin;
+    check();
+
+    std::cout << "Batched updates : " << updates / elapsed.count() << " per second (batches of " << batch_size << ")" << std::endl;
+}
+
 int
 main(int argc, char **argv)
 {
     if (argc < 2)
     {
-        std::cerr << "Usage : " << argv[0] << " datafilename " << std::endl << std::endl;
+        std::cerr << "Usage : " << argv[0] << " datafilename [dag]" << std::endl;
+        std::cerr << "        " << argv[0] << " bench [leaves] [updates]" << std::endl << std::endl;
 
         exit(-1);
     }
 
+    if (std::string(argv[1]) == "bench")
+    {
+        try
+        {
+            long long leaves = (argc > 2) ? std::stoll(argv[2]) : 1000000;
+            long long updates = (argc > 3) ? std::stoll(argv[3]) : 1000000;
+
+            if (updates < 0)
+                throw std::invalid_argument("Negative update count");
+
+            benchmark(std::max(0LL, leaves), updates);
+        }
+        catch(std::exception& e)
+        {
+            std::cerr << "Benchmark error: " << e.what() << std::endl;
+            std::exit(-1);
+        }
+
+        return 0;
+    }
+
+    bool with_dag = (argc > 2) && (std::string(argv[2]) == "dag");
+
     Work work;
+    MonkeyGraph graph;
     try
     {
         std::ifstream infile(argv[1]);
@@ -456,11 +883,23 @@ main(int argc, char **argv)
         std::string line;
         while (std::getline(infile, line))
         {
-            if (! line.empty())
+            if (line.empty())
+                continue;
+
+            if (with_dag)
+            {
+                graph.addMonkey(line);
+            }
+            else
             {
                 work.addMonkey(line);
             }
         }
+
+        if (with_dag)
+        {
+            graph.build();
+        }
     }
     catch(std::exception& e)
     {
@@ -468,6 +907,16 @@ main(int argc, char **argv)
         std::exit(-1);
     }
 
+    if (with_dag)
+    {
+        graph.solve();
+
+        std::cout << "Root has value " << graph.getRootNumber() << std::endl;
+        std::cout << "Human has value " << graph.getHumanNumber() << std::endl;
+
+        return 0;
+    }
+
     work.reduce();
     work.solve();
 
@@ -60,6 +60,56 @@ struct Limit
     int max;
 };
 
+/* Flat character buffer covering a rectangle of the plane.  Writes outside the rectangle are dropped */
+class Canvas
+{
+public:
+    Canvas(const Limit& a_x_axis, const Limit& a_y_axis) : x_axis(a_x_axis), y_axis(a_y_axis), width(a_x_axis.length()), buffer(a_x_axis.length() * a_y_axis.length(), ' ')
+    {
+    }
+
+    void set(int x, int y, char c)
+    {
+        if ((x < x_axis.min) || (x > x_axis.max) || (y < y_axis.min) || (y > y_axis.max))
+            return;
+
+        buffer[(y - y_axis.min) * width + (x - x_axis.min)] = c;
+    }
+
+    char get(int x, int y) const
+    {
+        return buffer[(y - y_axis.min) * width + (x - x_axis.min)];
+    }
+
+    /* The whole canvas as text, one line per row */
+    std::string str(bool trim) const
+    {
+        std::string out;
+        out.reserve(buffer.size() + y_axis.length());
+
+        for (int y = 0; y < y_axis.length(); ++y)
+        {
+            std::size_t length = width;
+            if (trim)
+            {
+                while ((length > 0) && (buffer[y * width + length - 1] == ' '))
+                    length--;
+            }
+
+            out.append(buffer, y * width, length);
+            out.push_back('\n');
+        }
+
+        return out;
+    }
+
+private:
+    Limit x_axis;
+    Limit y_axis;
+    std::size_t width;
+    std::string buffer;
+};
+
 struct Instruction
 {
     Instruction(int a_steps) : steps(a_steps), dir('=')
@@ -376,66 +426,76 @@ public:
         }
         else 
         {
-            int x = state.x;
-            int y = state.y;
-
             for (int j=0; j<i.steps; ++j)
             {
-                switch (state.direction.ev())
-                {
-                case Direction::NORTH:
-                    y -= 1;
-                    if (y < m_column_limits.at(x).min)
-                    {
-                        y = m_column_limits.at(x).max;
-                    }
-                    break;
-                case Direction::EAST:
-                    x += 1;
-                    if (x > m_row_limits.at(y).max)
-                    {
-                        x = m_row_limits.at(y).min;
-                    }
-                    break;
-                case Direction::SOUTH:
-                    y += 1;
-                    if (y > m_column_limits.at(x).max)
-                    {
-                        y = m_column_limits.at(x).min;
-                    }
-                    break;
-                case Direction::WEST:
-                    x -= 1;
-                    if (x < m_row_limits.at(y).min)
-                    {
-                        x = m_row_limits.at(y).max;
-                    }
-                    break;
-                }
-
-                if (m_walls.find({x, y}) != m_walls.end())
+                Runner next = step(state);
+                if ((next.x == state.x) && (next.y == state.y))
                     break;
 
-                state.x = x;
-                state.y = y;
+                state = next;
             }
         }
     }
 
-    Runner run(std::shared_ptr<InstructionList> instructions) const
+    /* One step forward, wrapping around the map.  Returns the same state when the step hits a wall */
+    Runner step(const Runner& state) const
     {
-        for (auto &c : m_column_limits)
-        {
-            if (! c.isValid())
-                throw std::invalid_argument("Column limits wrong");
-        }
+        int x = state.x;
+        int y = state.y;
 
-        for (auto &r : m_row_limits)
+        switch (state.direction.ev())
         {
-            if (! r.isValid())
-                throw std::invalid_argument("Row limits wrong");
+        case Direction::NORTH:
+            y -= 1;
+            if (y < m_column_limits.at(x).min)
+            {
+                y = m_column_limits.at(x).max;
+            }
+            break;
+        case Direction::EAST:
+            x += 1;
+            if (x > m_row_limits.at(y).max)
+            {
+                x = m_row_limits.at(y).min;
+            }
+            break;
+        case Direction::SOUTH:
+            y += 1;
+            if (y > m_column_limits.at(x).max)
+            {
+                y = m_column_limits.at(x).min;
+            }
+            break;
+        case Direction::WEST:
+            x -= 1;
+            if (x < m_row_limits.at(y).min)
+            {
+                x = m_row_limits.at(y).max;
+            }
+            break;
         }
 
+        if (m_walls.find({x, y}) != m_walls.end())
+            return state;
+
+        Runner ret(state);
+        ret.x = x;
+        ret.y = y;
+        return ret;
+    }
+
+    bool isOpen(int x, int y) const
+    {
+        if ((y < 0) || (y >= (int)m_row_limits.size()))
+            return false;
+        if ((x < m_row_limits[y].min) || (x > m_row_limits[y].max))
+            return false;
+
+        return m_walls.find({x, y}) == m_walls.end();
+    }
+
+    Runner start() const
+    {
         Runner state;
 
         state.x = m_row_limits[0].min;
@@ -449,6 +509,25 @@ public:
                 throw std::runtime_error("Can't find start position");
         }
 
+        return state;
+    }
+
+    Runner run(std::shared_ptr<InstructionList> instructions) const
+    {
+        for (auto &c : m_column_limits)
+        {
+            if (! c.isValid())
+                throw std::invalid_argument("Column limits wrong");
+        }
+
+        for (auto &r : m_row_limits)
+        {
+            if (! r.isValid())
+                throw std::invalid_argument("Row limits wrong");
+        }
+
+        Runner state = start();
+
         int n = 0;
         for (auto &i : *instructions)
         {
@@ -586,7 +665,7 @@ public:
 
     FaceId getId() const { return id; }
 
-    void draw(std::map<std::array<int,2>, char>& field, int scale_num=1, int scale_denom=1) const
+    void draw(Canvas& field, int scale_num=1, int scale_denom=1) const
     {        
         /* Draw a schematic representation of the face in the given field */
 
@@ -605,8 +684,8 @@ public:
                 tok = '+';
             }
 
-            field[{_x, _sy}] = tok;
-            field[{_x, y_right}] = tok;
+            field.set(_x, _sy, tok);
+            field.set(_x, y_right, tok);
         }
 
         for (int _y = _sy; _y <= y_right; ++_y)
@@ -617,57 +696,70 @@ public:
                 tok = '+';
             }
 
-            field[{_sx, _y}] = tok;
-            field[{x_right, _y}] = tok;
+            field.set(_sx, _y, tok);
+            field.set(x_right, _y, tok);
         }
 
-        field[{_sx + _ssize/2, _sy + _ssize/2}] = id;
+        field.set(_sx + _ssize/2, _sy + _ssize/2, id);
 
         auto origin = rotateCoords({0,0}, -rotation, _ssize);
-        field[{_sx + origin[0], _sy + origin[1]}] = '*';
+        field.set(_sx + origin[0], _sy + origin[1], '*');
 
         std::string x_toks(">v<^");
         std::string y_toks("v<^>");
 
         auto xp = rotateCoords({3, 0}, -rotation, _ssize);
-        field[{_sx + xp[0], _sy + xp[1]}] = 'x';
+        field.set(_sx + xp[0], _sy + xp[1], 'x');
         xp = rotateCoords({2, 0}, -rotation, _ssize);
-        field[{_sx + xp[0], _sy + xp[1]}] = x_toks[rotation%4];
+        field.set(_sx + xp[0], _sy + xp[1], x_toks[rotation%4]);
 
         auto yp = rotateCoords({0, 3}, -rotation, _ssize);
-        field[{_sx + yp[0], _sy + yp[1]}] = 'y';
+        field.set(_sx + yp[0], _sy + yp[1], 'y');
         yp = rotateCoords({0, 2}, -rotation, _ssize);
-        field[{_sx + yp[0], _sy + yp[1]}] = y_toks[rotation%4];
+        field.set(_sx + yp[0], _sy + yp[1], y_toks[rotation%4]);
 
         yp = rotateCoords({1, 1}, -rotation, _ssize);
-        field[{_sx + yp[0], _sy + yp[1]}] = '0' + rotation;
+        field.set(_sx + yp[0], _sy + yp[1], '0' + rotation);
 
 
         switch (getVirtualDirection(Direction::NORTH).ev())
         {
         case Direction::EAST:
-            field[{_sx + _ssize/2, _sy + 1}] = 'E';
+            field.set(_sx + _ssize/2, _sy + 1, 'E');
             break;
         case Direction::SOUTH:
-            field[{_sx + _ssize/2, _sy + 1}] = 'S';
+            field.set(_sx + _ssize/2, _sy + 1, 'S');
             break;
         case Direction::WEST:
-            field[{_sx + _ssize/2, _sy + 1}] = 'W';
+            field.set(_sx + _ssize/2, _sy + 1, 'W');
             break;
         case Direction::NORTH:
-            field[{_sx + _ssize/2, _sy + 1}] = 'N';
+            field.set(_sx + _ssize/2, _sy + 1, 'N');
             break;
         }
     }
 
-    void drawUnfolded(std::map<std::array<int,2>, char>& field) const
+    /* Area covered by draw() at the given scale */
+    void extent(Limit& x_axis, Limit& y_axis, int scale_num=1, int scale_denom=1) const
+    {
+        int _sx = x*scale_num/scale_denom;
+        int _sy = y*scale_num/scale_denom;
+        int _ssize = size*scale_num/scale_denom;
+
+        x_axis.update(_sx);
+        x_axis.update(_sx + _ssize - 1);
+        y_axis.update(_sy);
+        y_axis.update(_sy + _ssize - 1);
+    }
+
+    void drawUnfolded(Canvas& field) const
     {
         for (int _y = 0; _y < size; ++_y)
         {
             for (int _x = 0; _x < size; ++_x )
             {
                 auto pc = xfrmVirtualToPhysical({_x, _y});
-                field[pc] = isWall({_x, _y}) ? '#' : '.';
+                field.set(pc[0], pc[1], isWall({_x, _y}) ? '#' : '.');
             }
         }
     }
@@ -1014,95 +1106,63 @@ public:
 
     void drawUnfolded(std::ostream& os, std::list<std::array<int,2>> &path, const std::pair<const Face*, Runner>* state = nullptr, const std::set<std::array<int,2>>& highlights = std::set<std::array<int,2>>()) const
     {
-        std::map<std::array<int,2>, char> field;
         Limit x_axis;
         Limit y_axis;
 
         for (auto& f: faces)
         {
-            f.second->drawUnfolded(field);
-            /*
-            if ((state) && (state->first == f.second.get()))
-            {
-                f.second->drawRunner(path, state->second);
-            }
-            */
+            f.second->extent(x_axis, y_axis);
         }
 
-        for (auto& p : field)
+        Canvas field(x_axis, y_axis);
+
+        for (auto& f: faces)
         {
-            x_axis.update(p.first[0]);
-            y_axis.update(p.first[1]);
+            f.second->drawUnfolded(field);
         }
 
-        for (int y = y_axis.min; y <= y_axis.max; ++y)
+        for (auto p = path.begin(); p != path.end(); ++p)
         {
-            std::string line(x_axis.length(), ' ');
-
-            for (int x = x_axis.min; x<= x_axis.max; ++x)
-            {
-                auto c = field.find({x, y});
-                if (c != field.end())
-                    line[x - x_axis.min] = c->second;
-                
-                auto p = std::find_if(path.begin(), path.end(), [&](const std::array<int, 2>& p) { 
-                    return (p[0] == x) && (p[1] == y);
-                });
+            field.set((*p)[0], (*p)[1], (std::next(p) == path.end()) ? 'X' : '*');
+        }
 
-                if (p != path.end())
-                {
-                    auto on = std::next(p);
-                    if (on == path.end())
-                    {
-                        line[x - x_axis.min] = 'X';
-                    }
-                    else
-                    {
-                        line[x - x_axis.min] = '*';
-                    }
-                }
-            }
+        if (highlights.empty())
+        {
+            os << field.str(true);
+            return;
+        }
 
-            while ((! line.empty()) && (*line.rbegin() == ' '))
+        std::string out;
+        for (int y = y_axis.min; y <= y_axis.max; ++y)
+        {
+            for (int x = x_axis.min; x <= x_axis.max; ++x)
             {
-                line.pop_back();
-            }
+                char c = field.get(x, y);
 
-            /* Check for highlights */
-            std::string line2;
-            for (int x = x_axis.min; x<= x_axis.max; ++x)
-            {
                 if (highlights.find({x, y}) != highlights.end())
                 {
-                    line2 += "\033[1;31m";
-                    if (line[x] == ' ')
-                    {
-                        line2 += 'O';
-                    }
-                    else
-                    {
-                        line2 += line[x];
-                    }
-
-                    line2 += "\033[0m";
+                    out += "\033[1;31m";
+                    out += (c == ' ') ? 'O' : c;
+                    out += "\033[0m";
                 }
                 else
                 {
-                    line2 += line[x];                    
+                    out += c;
                 }
             }
 
-            os << line2 << std::endl;
+            while ((! out.empty()) && (out.back() == ' '))
+            {
+                out.pop_back();
+            }
+            out += '\n';
         }
-    }
 
+        os << out;
+    }
 
     void draw(std::ostream& os) const
     {
-        std::map<std::array<int,2>, char> field;
-        Limit x_axis;
-        Limit y_axis;
-
         int scale_num = 1;
         int scale_denom = 1;
 
@@ -1115,30 +1175,22 @@ public:
             scale_denom=5;
         } 
 
+        Limit x_axis;
+        Limit y_axis;
+
         for (auto& f: faces)
         {
-            f.second->draw(field, scale_num, scale_denom);
+            f.second->extent(x_axis, y_axis, scale_num, scale_denom);
         }
 
-        for (auto& p : field)
-        {
-            x_axis.update(p.first[0]);
-            y_axis.update(p.first[1]);
-        }
+        Canvas field(x_axis, y_axis);
 
-        for (int y = y_axis.min; y <= y_axis.max; ++y)
+        for (auto& f: faces)
         {
-            std::string line(x_axis.length(), ' ');
-
-            for (int x = x_axis.min; x<= x_axis.max; ++x)
-            {
-                auto c = field.find({x, y});
-                if (c != field.end())
-                    line[x - x_axis.min] = c->second;
-            }
-
-            os << line << std::endl;
+            f.second->draw(field, scale_num, scale_denom);
         }
+
+        os << field.str(false);
     }
 
     void printstate(const std::pair<const Face*, Runner>& s) const
@@ -1226,16 +1278,523 @@ private:
     std::map<Face::FaceId, std::shared_ptr<Face>> faces;
 };
 
+/* Folds any of the 11 cube nets, at any face size.  Every face tile of the unfolded map gets a 3D frame (normal,
+ * right and down unit vectors) by rolling the cube from tile to tile.  From those frames the 24 edge glues (face and
+ * side we arrive on, and whether the position along the edge is reversed) are computed once.  The walker only looks
+ * at that table.
+ */
+class CubeNet
+{
+public:
+
+    struct Glue
+    {
+        int face;
+        Direction direction;
+        bool flip;
+    };
+
+    using Vector = std::array<int, 3>;
+
+    CubeNet(const Grid& unfolded) : m_grid(unfolded)
+    {
+        int surface_area = 0;
+        for (auto &r : unfolded.m_row_limits)
+        {
+            surface_area += r.length();
+        }
+
+        if ((surface_area == 0) || ((surface_area % 6) != 0))
+            throw std::invalid_argument("Surface area is not multiple of number of faces");
+
+        m_size = 1;
+        while (m_size * m_size < surface_area / 6) ++m_size;
+        if (m_size * m_size != surface_area / 6)
+            throw std::invalid_argument("Surface dimension is not square of face surface");
+
+        m_tiles_x = (unfolded.m_column_limits.size() + m_size - 1) / m_size;
+        m_tiles_y = (unfolded.m_row_limits.size() + m_size - 1) / m_size;
+        m_tile.assign(m_tiles_x * m_tiles_y, -1);
+
+        for (int ty = 0; ty < m_tiles_y; ++ty)
+        {
+            const Limit& row = unfolded.m_row_limits[ty * m_size];
+            for (int tx = 0; tx < m_tiles_x; ++tx)
+            {
+                if ((tx * m_size >= row.min) && (tx * m_size <= row.max))
+                {
+                    if (m_origins.size() == 6)
+                        throw std::invalid_argument("More than 6 faces in the net");
+
+                    m_tile[ty * m_tiles_x + tx] = m_origins.size();
+                    m_origins.push_back({tx * m_size, ty * m_size});
+                }
+            }
+        }
+
+        if (m_origins.size() != 6)
+            throw std::invalid_argument("Net does not have 6 faces");
+
+        fold();
+        glue();
+    }
+
+    const std::array<std::array<Glue, Direction::N_DIRECTIONS>, 6>& glues() const { return m_glue; }
+
+    /* One step in unfolded map coordinates.  Returns the same state when the step hits a wall */
+    Runner step(const Runner& r) const
+    {
+        int face = faceAt(r.x, r.y);
+        int lx = r.x - m_origins[face][0];
+        int ly = r.y - m_origins[face][1];
+        Direction dir = r.direction;
+
+        switch (dir.ev())
+        {
+        case Direction::EAST:  lx++; break;
+        case Direction::SOUTH: ly++; break;
+        case Direction::WEST:  lx--; break;
+        case Direction::NORTH: ly--; break;
+        }
+
+        if ((lx < 0) || (ly < 0) || (lx >= m_size) || (ly >= m_size))
+        {
+            const Glue& g = m_glue[face][dir.nv()];
+
+            int along = ((dir == Direction::EAST) || (dir == Direction::WEST)) ? ly : lx;
+            if (g.flip)
+            {
+                along = m_size - 1 - along;
+            }
+
+            face = g.face;
+            dir = g.direction;
+
+            switch (dir.ev())
+            {
+            case Direction::EAST:  lx = 0;          ly = along;      break;
+            case Direction::SOUTH: lx = along;      ly = 0;          break;
+            case Direction::WEST:  lx = m_size - 1; ly = along;      break;
+            case Direction::NORTH: lx = along;      ly = m_size - 1; break;
+            }
+        }
+
+        Runner ret;
+        ret.x = m_origins[face][0] + lx;
+        ret.y = m_origins[face][1] + ly;
+        ret.direction = dir;
+
+        if (! m_grid.isOpen(ret.x, ret.y))
+            return r;
+
+        return ret;
+    }
+
+    /* Map with the face numbers in the middle of each face and the face glued to each edge in the middle of that edge */
+    void draw(std::ostream& os) const
+    {
+        const int width = m_tiles_x * m_size + 1;
+        std::string buffer(width * m_tiles_y * m_size, ' ');
+
+        for (int y = 0; y < m_tiles_y * m_size; ++y)
+        {
+            for (int x = 0; x < m_tiles_x * m_size; ++x)
+            {
+                if (m_tile[(y / m_size) * m_tiles_x + (x / m_size)] >= 0)
+                {
+                    buffer[y * width + x] = m_grid.isOpen(x, y) ? '.' : '#';
+                }
+            }
+            buffer[y * width + width - 1] = '\n';
+        }
+
+        for (int f = 0; f < 6; ++f)
+        {
+            const int ox = m_origins[f][0];
+            const int oy = m_origins[f][1];
+            const int mid = m_size / 2;
+
+            buffer[(oy + mid) * width + ox + mid] = 'A' + f;
+            buffer[(oy + mid) * width + ox + m_size - 1] = 'a' + m_glue[f][Direction::EAST].face;
+            buffer[(oy + m_size - 1) * width + ox + mid] = 'a' + m_glue[f][Direction::SOUTH].face;
+            buffer[(oy + mid) * width + ox] = 'a' + m_glue[f][Direction::WEST].face;
+            buffer[oy * width + ox + mid] = 'a' + m_glue[f][Direction::NORTH].face;
+        }
+
+        os << buffer;
+    }
+
+private:
+
+    static Vector neg(const Vector& v)
+    {
+        return {-v[0], -v[1], -v[2]};
+    }
+
+    int faceAt(int x, int y) const
+    {
+        int face = m_tile.at((y / m_size) * m_tiles_x + (x / m_size));
+        if (face < 0)
+            throw std::invalid_argument("Position not on any face");
+        return face;
+    }
+
+    /* Outward vector of a face edge */
+    Vector outward(int face, const Direction& dir) const
+    {
+        switch (dir.ev())
+        {
+        case Direction::EAST:  return m_right[face];
+        case Direction::SOUTH: return m_down[face];
+        case Direction::WEST:  return neg(m_right[face]);
+        case Direction::NORTH: return neg(m_down[face]);
+        }
+        return {};
+    }
+
+    /* Direction in which the position along an edge counts up */
+    Vector along(int face, const Direction& dir) const
+    {
+        return ((dir == Direction::EAST) || (dir == Direction::WEST)) ? m_down[face] : m_right[face];
+    }
+
+    void fold()
+    {
+        std::array<bool, 6> placed{};
+        std::vector<int> todo{0};
+
+        m_normal[0] = {0, 0, 1};
+        m_right[0] = {1, 0, 0};
+        m_down[0] = {0, 1, 0};
+        placed[0] = true;
+
+        while (! todo.empty())
+        {
+            int f = todo.back();
+            todo.pop_back();
+
+            for (auto &d : Direction::all)
+            {
+                int tx = m_origins[f][0] / m_size;
+                int ty = m_origins[f][1] / m_size;
+
+                switch (d)
+                {
+                case Direction::EAST:  tx++; break;
+                case Direction::SOUTH: ty++; break;
+                case Direction::WEST:  tx--; break;
+                case Direction::NORTH: ty--; break;
+                }
+
+                if ((tx < 0) || (ty < 0) || (tx >= m_tiles_x) || (ty >= m_tiles_y))
+                    continue;
+
+                int n = m_tile[ty * m_tiles_x + tx];
+                if ((n < 0) || placed[n])
+                    continue;
+
+                /* Roll the cube over the shared edge */
+                m_normal[n] = outward(f, d);
+                m_right[n] = m_right[f];
+                m_down[n] = m_down[f];
+
+                switch (d)
+                {
+                case Direction::EAST:  m_right[n] = neg(m_normal[f]); break;
+                case Direction::SOUTH: m_down[n] = neg(m_normal[f]); break;
+                case Direction::WEST:  m_right[n] = m_normal[f]; break;
+                case Direction::NORTH: m_down[n] = m_normal[f]; break;
+                }
+
+                placed[n] = true;
+                todo.push_back(n);
+            }
+        }
+
+        for (int f = 0; f < 6; ++f)
+        {
+            for (int g = 0; g < f; ++g)
+            {
+                if (m_normal[f] == m_normal[g])
+                    throw std::invalid_argument("Net does not fold into a cube");
+            }
+        }
+    }
+
+    void glue()
+    {
+        for (int f = 0; f < 6; ++f)
+        {
+            for (auto &d : Direction::all)
+            {
+                Vector out = outward(f, d);
+
+                int target = std::find(m_normal.begin(), m_normal.end(), out) - m_normal.begin();
+                if (target == 6)
+                    throw std::invalid_argument("Edge without a neighbouring face");
+
+                bool found = false;
+                for (auto &e : Direction::all)
+                {
+                    if (outward(target, e) == m_normal[f])
+                    {
+                        m_glue[f][d] = Glue{target, Direction(e) + 2, along(f, d) != along(target, e)};
+                        found = true;
+                    }
+                }
+
+                if (! found)
+                    throw std::invalid_argument("Edge can't be glued");
+            }
+        }
+    }
+
+    const Grid& m_grid;
+    int m_size;
+    int m_tiles_x;
+    int m_tiles_y;
+    std::vector<int> m_tile;
+    std::vector<std::array<int, 2>> m_origins;
+
+    std::array<Vector, 6> m_normal;
+    std::array<Vector, 6> m_right;
+    std::array<Vector, 6> m_down;
+
+    std::array<std::array<Glue, Direction::N_DIRECTIONS>, 6> m_glue;
+};
+
+/* Precomputed walker.  Every open cell and direction is a state, next holds the state after one step (itself when
+ * blocked by a wall) for whatever topology the step function implements.  On top of that we keep the number of steps
+ * until the walker gets stuck against a wall and where, so long moves resolve in O(1), and binary lifting tables for
+ * moves that end before the wall or go round a wall-free loop.
+ */
+class JumpTable
+{
+public:
+
+    static constexpr int infinite = std::numeric_limits<int>::max();
+
+    template<typename Step>
+    JumpTable(const Grid& grid, Step step)
+    {
+        m_width = grid.m_column_limits.size();
+        m_cell.assign(m_width * grid.m_row_limits.size(), -1);
+
+        for (int y = 0; y < (int)grid.m_row_limits.size(); ++y)
+        {
+            for (int x = grid.m_row_limits[y].min; x <= grid.m_row_limits[y].max; ++x)
+            {
+                if (grid.isOpen(x, y))
+                {
+                    m_cell[y * m_width + x] = m_cells.size();
+                    m_cells.push_back({x, y});
+                }
+            }
+        }
+
+        const int n_states = m_cells.size() * Direction::N_DIRECTIONS;
+        std::vector<int> next(n_states);
+
+        for (int s = 0; s < n_states; ++s)
+        {
+            next[s] = toState(step(toRunner(s)));
+        }
+
+        resolveStops(next);
+
+        int levels = 1;
+        while ((1 << levels) < n_states) ++levels;
+
+        m_up.push_back(std::move(next));
+        for (int k = 1; k < levels; ++k)
+        {
+            const auto& prev = m_up.back();
+            std::vector<int> up(n_states);
+            for (int s = 0; s < n_states; ++s)
+            {
+                up[s] = prev[prev[s]];
+            }
+            m_up.push_back(std::move(up));
+        }
+    }
+
+    Runner run(const Runner& start, std::shared_ptr<InstructionList> instructions) const
+    {
+        int s = toState(start);
+
+        for (auto &i : *instructions)
+        {
+            if (i.dir == 'R')
+            {
+                s = (s & ~3) | ((s + 1) & 3);
+            }
+            else if (i.dir == 'L')
+            {
+                s = (s & ~3) | ((s + 3) & 3);
+            }
+            else
+            {
+                s = advance(s, i.steps);
+            }
+        }
+
+        return toRunner(s);
+    }
+
+    int advance(int s, int64_t steps) const
+    {
+        if (steps >= m_dist[s])
+            return m_stop[s];
+
+        if (m_cycle[s] > 0)
+        {
+            steps %= m_cycle[s];
+        }
+
+        const int top = m_up.size() - 1;
+        while (steps >= (int64_t(1) << top))
+        {
+            s = m_up[top][s];
+            steps -= int64_t(1) << top;
+        }
+
+        for (int k = top; k >= 0; --k)
+        {
+            if (steps & (int64_t(1) << k))
+            {
+                s = m_up[k][s];
+            }
+        }
+
+        return s;
+    }
+
+private:
+
+    int toState(const Runner& r) const
+    {
+        int cell = m_cell.at(r.y * m_width + r.x);
+        if (cell < 0)
+            throw std::invalid_argument("Runner not on an open cell");
+
+        return cell * Direction::N_DIRECTIONS + r.direction.nv();
+    }
+
+    Runner toRunner(int s) const
+    {
+        Runner r;
+        r.x = m_cells[s / Direction::N_DIRECTIONS][0];
+        r.y = m_cells[s / Direction::N_DIRECTIONS][1];
+        r.direction = Direction(std::size_t(s % Direction::N_DIRECTIONS));
+        return r;
+    }
+
+    /* Walk the functional graph of next once.  States end up either stuck against a wall after m_dist steps, or on
+     * a loop without walls of length m_cycle.
+     */
+    void resolveStops(const std::vector<int>& next)
+    {
+        const int n_states = next.size();
+
+        m_dist.assign(n_states, infinite);
+        m_stop.assign(n_states, -1);
+        m_cycle.assign(n_states, 0);
+
+        std::vector<char> mark(n_states, 0);
+        std::vector<int> on_path(n_states, -1);
+        std::vector<int> path;
+
+        for (int s = 0; s < n_states; ++s)
+        {
+            if (mark[s])
+                continue;
+
+            path.clear();
+            int u = s;
+            while (! mark[u])
+            {
+                mark[u] = 1;
+                on_path[u] = path.size();
+                path.push_back(u);
+                u = next[u];
+            }
+
+            std::size_t resolved = path.size();
+
+            if ((mark[u] == 1) && (next[u] == u))
+            {
+                /* Stuck against a wall */
+                m_dist[u] = 0;
+                m_stop[u] = u;
+                resolved = on_path[u];
+            }
+            else if (mark[u] == 1)
+            {
+                /* Loop without walls */
+                int length = path.size() - on_path[u];
+                for (std::size_t i = on_path[u]; i < path.size(); ++i)
+                {
+                    m_cycle[path[i]] = length;
+                }
+                resolved = on_path[u];
+            }
+
+            for (std::size_t i = resolved; i-- > 0;)
+            {
+                int p = path[i];
+                int q = next[p];
+
+                if (m_dist[q] != infinite)
+                {
+                    m_dist[p] = m_dist[q] + 1;
+                    m_stop[p] = m_stop[q];
+                }
+            }
+
+            for (auto &p : path)
+            {
+                mark[p] = 2;
+                on_path[p] = -1;
+            }
+        }
+    }
+
+    int m_width;
+    std::vector<int> m_cell;
+    std::vector<std::array<int, 2>> m_cells;
+
+    std::vector<int> m_dist;
+    std::vector<int> m_stop;
+    std::vector<int> m_cycle;
+    std::vector<std::vector<int>> m_up;
+};
+
 int
 main(int argc, char **argv)
 {
     if (argc < 2)
     {
-        std::cerr << "Usage : " << argv[0] << " datafilename " << std::endl << std::endl;
+        std::cerr << "Usage : " << argv[0] << " datafilename [jump] [draw]" << std::endl << std::endl;
 
         exit(-1);
     }
 
+    bool with_jump = false;
+    bool with_draw = false;
+
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string option(argv[i]);
+        if (option == "jump")
+        {
+            with_jump = true;
+        }
+        else if (option == "draw")
+        {
+            with_draw = true;
+        }
+    }
+
     Grid grid;
     std::shared_ptr<InstructionList> instructions;
 
@@ -1271,6 +1830,30 @@ main(int argc, char **argv)
         std::exit(-1);
     }
 
+    if (with_jump)
+    {
+        JumpTable flat(grid, [&](const Runner& r) { return grid.step(r); });
+        auto state = flat.run(grid.start(), instructions);
+
+        std::cout << "State x=" << state.x << ", y=" << state.y << ", dir=" << state.direction << std::endl;
+        std::cout << "Password=" << state.toPassword() << std::endl << std::endl << std::endl << std::endl;
+
+        CubeNet net(grid);
+        if (with_draw)
+        {
+            net.draw(std::cout);
+            std::cout << std::endl;
+        }
+
+        JumpTable folded(grid, [&](const Runner& r) { return net.step(r); });
+        auto state2 = folded.run(grid.start(), instructions);
+
+        std::cout << "State x=" << state2.x << ", y=" << state2.y << ", dir=" << state2.direction << std::endl;
+        std::cout << "Password=" << state2.toPassword() << std::endl << std::endl << std::endl << std::endl;
+
+        return 0;
+    }
+
     auto state = grid.run(instructions);
 
     std::cout << "State x=" << state.x << ", y=" << state.y << ", dir=" << state.direction << std::endl;
@@ -1280,6 +1863,12 @@ main(int argc, char **argv)
 
     // cube.drawUnfolded(std::cout);
 
+    if (with_draw)
+    {
+        cube.draw(std::cout);
+        std::cout << std::endl;
+    }
+
     auto state2 = cube.run(instructions, false);
     std::cout << "State x=" << state2.x << ", y=" << state2.y << ", dir=" << state2.direction << std::endl;
     std::cout << "Password=" << state2.toPassword() << std::endl << std::endl << std::endl << std::endl;
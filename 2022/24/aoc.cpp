@@ -3,6 +3,8 @@
 #include <iostream>
 #include <limits>
 #include <vector>
+#include <map>
+#include <numeric>
 #include <cstdint>
 #include <fstream>
 #include <algorithm>
@@ -56,6 +58,28 @@ public:
         return false;
     }
 
+    /* Call fn for every position covered by a blizzard of this row/column at the given cycle */
+    template<typename F>
+    void forEachOccupied(std::size_t a_Cycle, F&& fn) const
+    {
+        a_Cycle %= m_Size;
+
+        for (auto &f: m_Forward)
+        {
+            fn((f + a_Cycle) % m_Size);
+        }
+
+        for (auto &f: m_Backward)
+        {
+            fn((m_Size + f - a_Cycle) % m_Size);
+        }
+    }
+
+    std::size_t size() const
+    {
+        return m_Size;
+    }
+
     char getStatus(std::size_t position, std::size_t a_Cycle) const
     {
         char ret = '.';
@@ -141,6 +165,174 @@ std::ostream& operator<<(std::ostream& os, const Coordinate& co)
     return os;
 }
 
+/* Bitmap of the valley, one bit per cell, rows padded to whole 64 bit words */
+class BitRows
+{
+public:
+    BitRows(std::size_t a_width, std::size_t a_height) : m_Width(a_width), m_Height(a_height), m_Words((a_width + 63) / 64), m_Bits(m_Words * a_height, 0)
+    {
+        m_TailMask = (m_Width % 64) ? ((uint64_t(1) << (m_Width % 64)) - 1) : ~uint64_t(0);
+    }
+
+    uint64_t* row(std::size_t y)
+    {
+        return m_Bits.data() + y * m_Words;
+    }
+
+    const uint64_t* row(std::size_t y) const
+    {
+        return m_Bits.data() + y * m_Words;
+    }
+
+    void set(const Coordinate& pos)
+    {
+        row(pos.y)[pos.x / 64] |= uint64_t(1) << (pos.x % 64);
+    }
+
+    bool test(const Coordinate& pos) const
+    {
+        return (row(pos.y)[pos.x / 64] >> (pos.x % 64)) & 1;
+    }
+
+    bool operator==(const BitRows& rhs) const
+    {
+        return m_Bits == rhs.m_Bits;
+    }
+
+    /* Call fn for every set bit */
+    template<typename F>
+    void forEach(F&& fn) const
+    {
+        for (std::size_t y = 0; y < m_Height; ++y)
+        {
+            const uint64_t* r = row(y);
+            for (std::size_t w = 0; w < m_Words; ++w)
+            {
+                for (uint64_t v = r[w]; v != 0; v &= v - 1)
+                {
+                    fn(Coordinate(w * 64 + __builtin_ctzll(v), y));
+                }
+            }
+        }
+    }
+
+    bool empty() const
+    {
+        return std::all_of(m_Bits.begin(), m_Bits.end(), [](uint64_t w) { return w == 0; });
+    }
+
+    void clear()
+    {
+        std::fill(m_Bits.begin(), m_Bits.end(), 0);
+    }
+
+    std::size_t width() const { return m_Width; }
+    std::size_t height() const { return m_Height; }
+    std::size_t words() const { return m_Words; }
+    uint64_t tailMask() const { return m_TailMask; }
+
+private:
+    std::size_t m_Width;
+    std::size_t m_Height;
+    std::size_t m_Words;
+    uint64_t m_TailMask;
+    std::vector<uint64_t> m_Bits;
+};
+
+/* Blizzard positions for every cycle, precomputed once.  Horizontal blizzards repeat every width cycles,
+ * vertical ones every height cycles, so both are stored separately instead of over lcm(width, height).
+ */
+class OccupancyTable
+{
+public:
+    OccupancyTable() = default;
+
+    OccupancyTable(const std::vector<Blizzard>& rows, const std::vector<Blizzard>& cols)
+    {
+        std::size_t width = cols.size();
+        std::size_t height = rows.size();
+
+        for (std::size_t cycle = 0; cycle < width; ++cycle)
+        {
+            BitRows& bits = m_Horizontal.emplace_back(width, height);
+            for (std::size_t y = 0; y < height; ++y)
+            {
+                rows[y].forEachOccupied(cycle, [&](std::size_t x) { bits.set(Coordinate(x, y)); });
+            }
+        }
+
+        for (std::size_t cycle = 0; cycle < height; ++cycle)
+        {
+            BitRows& bits = m_Vertical.emplace_back(width, height);
+            for (std::size_t x = 0; x < width; ++x)
+            {
+                cols[x].forEachOccupied(cycle, [&](std::size_t y) { bits.set(Coordinate(x, y)); });
+            }
+        }
+    }
+
+    const uint64_t* horizontal(std::size_t y, std::size_t cycle) const
+    {
+        return m_Horizontal[cycle % m_Horizontal.size()].row(y);
+    }
+
+    const uint64_t* vertical(std::size_t y, std::size_t cycle) const
+    {
+        return m_Vertical[cycle % m_Vertical.size()].row(y);
+    }
+
+    bool isOccupied(const Coordinate& pos, std::size_t cycle) const
+    {
+        return m_Horizontal[cycle % m_Horizontal.size()].test(pos) || m_Vertical[cycle % m_Vertical.size()].test(pos);
+    }
+
+    /* After this many cycles all blizzards are back at their starting position */
+    std::size_t period() const
+    {
+        return std::lcm(m_Horizontal.size(), m_Vertical.size());
+    }
+
+private:
+    std::vector<BitRows> m_Horizontal;
+    std::vector<BitRows> m_Vertical;
+};
+
+/* Earliest cycle at which every cell of the valley can be reached from a given start */
+class ArrivalTable
+{
+public:
+    static constexpr std::size_t unreachable = std::numeric_limits<std::size_t>::max();
+
+    ArrivalTable() = default;
+    ArrivalTable(std::size_t a_width, std::size_t a_height) : m_Width(a_width), m_Arrival(a_width * a_height, unreachable)
+    {
+    }
+
+    std::size_t at(const Coordinate& pos) const
+    {
+        return m_Arrival.at(pos.y * m_Width + pos.x);
+    }
+
+    /* Returns true if this is the first time pos is reached */
+    bool reach(const Coordinate& pos, std::size_t cycle)
+    {
+        std::size_t& a = m_Arrival.at(pos.y * m_Width + pos.x);
+        if (a != unreachable) return false;
+
+        a = cycle;
+        return true;
+    }
+
+    std::size_t size() const
+    {
+        return m_Arrival.size();
+    }
+
+private:
+    std::size_t m_Width = 0;
+    std::vector<std::size_t> m_Arrival;
+};
+
 class Grid
 {
 public:
@@ -183,16 +375,18 @@ public:
                 }
             }
         }
+
+        occupancy = OccupancyTable(rows, cols);
     }
 
     bool isOccupied(const Coordinate& pos, std::size_t cycle=0) const
     {
-        return rows.at(pos.y).isOccupied(pos.x, cycle) || cols.at(pos.x).isOccupied(pos.y, cycle);
+        return occupancy.isOccupied(pos, cycle);
     }
 
     std::size_t walk() const
     {
-        return walk(Coordinate(entrance_pos, 0), Coordinate(exit_pos, rows.size()-1), 1);
+        return walk({Coordinate(entrance_pos, 0), Coordinate(exit_pos, rows.size()-1)}, 1);
     }
 
     std::size_t walkandreturn() const
@@ -200,46 +394,88 @@ public:
         Coordinate at_entrance(entrance_pos, 0);
         Coordinate at_exit(exit_pos, rows.size()-1);
 
-        std::size_t first_leg = walk(at_entrance, at_exit, 1);
-        std::size_t second_leg = walk(at_exit, at_entrance, first_leg+1);
-    
-        return walk(at_entrance, at_exit, second_leg+1);
+        return walk({at_entrance, at_exit, at_entrance, at_exit}, 1);
     }
 
-    std::size_t walk(const Coordinate& start, const Coordinate& destination, std::size_t first_cycle) const
+    /* Visit all waypoints in order, each leg leaving one cycle after arriving at the previous waypoint.  Returns the
+     * cycle at which the last waypoint is reached.
+     */
+    std::size_t walk(const std::vector<Coordinate>& waypoints, std::size_t first_cycle) const
     {
+        std::size_t arrival = first_cycle;
 
-        while (true)
+        for (std::size_t i = 1; i < waypoints.size(); ++i)
         {
-            /* First find first cycle which has the start position unoccupied */
-            while (isOccupied(start, first_cycle+1))
-            {
-                first_cycle++;
-            }
+            arrival = walk(waypoints[i-1], waypoints[i], first_cycle);
+            if (arrival == ArrivalTable::unreachable)
+                break;
 
-            std::size_t cycle = first_cycle++;
+            first_cycle = arrival + 1;
+        }
 
-            std::pair<bool, std::set<Coordinate>> state;
-            state.first = false;
-            state.second.insert(start);
+        return arrival;
+    }
 
-            while (! state.second.empty())
-            {
-                cycle++;
-                auto ret = walk(state.second, cycle, destination);
+    std::size_t walk(const Coordinate& start, const Coordinate& destination, std::size_t first_cycle) const
+    {
+        std::size_t arrival = ArrivalTable::unreachable;
 
-                if (ret.first)
-                    return cycle;
+        advance(start, first_cycle, [&](const BitRows& frontier, std::size_t cycle) {
+            if (! frontier.test(destination))
+                return false;
 
-                state = ret;
-            }
+            arrival = cycle;
+            return true;
+        });
+
+        return arrival;
+    }
+
+    /* Earliest arrival at every cell when leaving start after first_cycle.  Tables are cached per start and phase
+     * within the blizzard period, so repeated queries only pay for the lookup.  Only the most recent tables are
+     * kept, so the returned reference is valid until the next call.
+     */
+    const ArrivalTable& arrivals(const Coordinate& start, std::size_t first_cycle) const
+    {
+        auto key = std::make_pair(start, first_cycle % occupancy.period());
+
+        auto it = arrival_cache.find(key);
+        if (it != arrival_cache.end())
+            return it->second;
 
-            /* If we end up here it was not possible to reach the target.  That means we wait until the next opportunity arises to start
-             * the travel.
-             */
+        if (arrival_cache.size() >= max_cached_tables)
+        {
+            arrival_cache.erase(arrival_order.front());
+            arrival_order.pop_front();
         }
 
-        return std::numeric_limits<std::size_t>::max();
+        ArrivalTable table(cols.size(), rows.size());
+        std::size_t reached = 0;
+
+        advance(start, key.second, [&](const BitRows& frontier, std::size_t cycle) {
+            frontier.forEach([&](const Coordinate& pos) {
+                if (table.reach(pos, cycle)) reached++;
+            });
+
+            return reached == table.size();
+        });
+
+        arrival_order.push_back(key);
+        return arrival_cache.emplace(key, std::move(table)).first->second;
+    }
+
+    bool isInside(const Coordinate& pos) const
+    {
+        return (pos.x < cols.size()) && (pos.y < rows.size());
+    }
+
+    std::size_t query(const Coordinate& start, const Coordinate& destination, std::size_t first_cycle) const
+    {
+        std::size_t arrival = arrivals(start, first_cycle).at(destination);
+        if (arrival == ArrivalTable::unreachable)
+            return arrival;
+
+        return arrival + first_cycle - (first_cycle % occupancy.period());
     }
 
     void Draw(std::ostream& os, std::size_t cycle=0) const
@@ -309,70 +545,81 @@ public:
 
 private:
 
-    std::vector<Coordinate> getNeighbours(const Coordinate& pos) const
+    /* Run the frontier from start, stepping onto it at any cycle after first_cycle where it is free, and hand every
+     * cycle's frontier to visit until it returns true.  Because waiting at the start is always possible the frontier
+     * only grows from one blizzard period to the next; once it stops growing nothing new can be reached and we give up.
+     */
+    template<typename F>
+    bool advance(const Coordinate& start, std::size_t first_cycle, F&& visit) const
     {
-        std::vector<Coordinate> ret;
-        ret.reserve(4);
+        BitRows current(cols.size(), rows.size());
+        BitRows next(cols.size(), rows.size());
+        BitRows snapshot(cols.size(), rows.size());
 
-        /* Put the ones where we go up or left first */
-        if (pos.x > 0)
-        {
-            ret.emplace_back(pos.x-1, pos.y);
-        }
-        if (pos.y > 0)
-        {
-            ret.emplace_back(pos.x, pos.y-1);
-        }        
-        if (pos.x+1 < cols.size())
-        {
-            ret.emplace_back(pos.x+1, pos.y);
-        }
-        if (pos.y+1 < rows.size())
+        const std::size_t period = occupancy.period();
+
+        for (std::size_t cycle = first_cycle + 1; ; ++cycle)
         {
-            ret.emplace_back(pos.x, pos.y+1);
-        }
+            if (! isOccupied(start, cycle))
+            {
+                current.set(start);
+            }
 
-        return ret;
+            if (visit(static_cast<const BitRows&>(current), cycle))
+                return true;
+
+            if (((cycle - first_cycle) % period) == 0)
+            {
+                if (current == snapshot)
+                    return false;
+
+                snapshot = current;
+            }
+
+            step(current, next, cycle);
+            std::swap(current, next);
+        }
     }
 
-    std::pair<bool, std::set<Coordinate>> walk(const std::set<Coordinate>& pos, std::size_t cycle, const Coordinate& destination) const
+    /* Expand every reachable position to itself and its 4 neighbours, then drop everything covered by
+     * a blizzard in this cycle.  Works on whole 64 bit words, so a cycle costs O(width * height / 64).
+     */
+    void step(const BitRows& current, BitRows& next, std::size_t cycle) const
     {
-        std::set<Coordinate> newpos;
+        const std::size_t words = current.words();
 
-        for (auto &p : pos)
+        for (std::size_t y = 0; y < current.height(); ++y)
         {
-            if (p == destination)
-                /* We have arrived */
-                return std::make_pair(true, std::set<Coordinate>());
-
-            if (newpos.find(p) == newpos.end())
+            const uint64_t* cur = current.row(y);
+            const uint64_t* above = (y > 0) ? current.row(y-1) : nullptr;
+            const uint64_t* below = (y+1 < current.height()) ? current.row(y+1) : nullptr;
+            const uint64_t* horiz = occupancy.horizontal(y, cycle);
+            const uint64_t* vert = occupancy.vertical(y, cycle);
+            uint64_t* out = next.row(y);
+
+            for (std::size_t w = 0; w < words; ++w)
             {
-                if (! isOccupied(p, cycle))
-                {
-                    newpos.insert(p);
-                }
-            }
+                uint64_t v = cur[w];
 
-            /* Check if we can move to any of our neighbour positions in the next cycle */
-            for (auto &n: getNeighbours(p))
-            {
-                /* Check if this position has already been reached by another path in this cycle */
-                if (newpos.find(n) == newpos.end())
-                {
-                    /* If not, test it */
-                    if (! isOccupied(n, cycle))
-                    {
-                        newpos.insert(n);
-                    }
-                }
+                v |= (cur[w] << 1) | ((w > 0) ? (cur[w-1] >> 63) : 0);
+                v |= (cur[w] >> 1) | ((w+1 < words) ? (cur[w+1] << 63) : 0);
+
+                if (above) v |= above[w];
+                if (below) v |= below[w];
+
+                out[w] = v & ~(horiz[w] | vert[w]);
             }
-        }
 
-        return std::make_pair(false, newpos);
+            out[words-1] &= current.tailMask();
+        }
     }
 
     std::vector<Blizzard> rows;
     std::vector<Blizzard> cols;
+    OccupancyTable occupancy;
+    static constexpr std::size_t max_cached_tables = 16;
+    mutable std::map<std::pair<Coordinate, std::size_t>, ArrivalTable> arrival_cache;
+    mutable std::deque<std::pair<Coordinate, std::size_t>> arrival_order;
     std::size_t entrance_pos;
     std::size_t exit_pos;
 };
@@ -382,7 +629,7 @@ main(int argc, char **argv)
 {
     if (argc < 2)
     {
-        std::cerr << "Usage : " << argv[0] << " datafilename " << std::endl << std::endl;
+        std::cerr << "Usage : " << argv[0] << " datafilename [query sx sy dx dy t0]" << std::endl << std::endl;
 
         exit(-1);
     }
@@ -391,8 +638,28 @@ main(int argc, char **argv)
     std::size_t entrance_pos = 0;
     std::size_t exit_pos = 0;
     std::vector<std::string> lines;
+
+    bool query = (argc > 2) && (std::string(argv[2]) == "query");
+    std::array<std::size_t, 5> query_args{};
     try
     {
+        if (query)
+        {
+            /* sx sy dx dy t0 */
+            if (argc < 8)
+                throw std::invalid_argument("missing query arguments");
+
+            for (std::size_t i = 0; i < query_args.size(); ++i)
+            {
+                std::string arg(argv[3 + i]);
+
+                if (arg.empty() || (arg.find_first_not_of("0123456789") != std::string::npos))
+                    throw std::invalid_argument("can't parse query argument " + arg);
+
+                query_args[i] = std::stoul(arg);
+            }
+        }
+
         std::ifstream infile(argv[1]);
 
         std::string line;
@@ -434,11 +701,39 @@ main(int argc, char **argv)
     catch(std::exception& e)
     {
         std::cerr << "Reading data error: " << e.what() << std::endl;
+        if (query)
+            std::cerr << "Usage : " << argv[0] << " datafilename query sx sy dx dy t0" << std::endl;
         std::exit(-1);
     }
 
     Grid grid(grid_width, lines, entrance_pos, exit_pos);
 
+    if (query)
+    {
+        /* Coordinates are inside the valley walls, the entrance is at (entrance, 0) */
+        Coordinate start(query_args[0], query_args[1]);
+        Coordinate destination(query_args[2], query_args[3]);
+        std::size_t first_cycle = query_args[4];
+
+        if ((! grid.isInside(start)) || (! grid.isInside(destination)))
+        {
+            std::cerr << "Coordinates outside the valley" << std::endl;
+            exit(-1);
+        }
+
+        auto arrival = grid.query(start, destination, first_cycle);
+        if (arrival == ArrivalTable::unreachable)
+        {
+            std::cout << "Unreachable" << std::endl;
+        }
+        else
+        {
+            std::cout << "Arrival at cycle " << arrival << std::endl;
+        }
+
+        return 0;
+    }
+
     auto scoreA = grid.walk();
     std::cout << "Best path A " << scoreA << std::endl;
 
@@ -23,6 +23,8 @@
 #include <functional>
 #include <optional>
 #include <string_view>
+#include <chrono>
+#include <cstdio>
 
 static bool with_debug = true;
 using namespace std::string_view_literals;
@@ -117,6 +119,41 @@ public:
         return os;
     }
 
+    /* Same picture as write(), but every row is built in one string and the
+     * whole frame goes out with a single fwrite.
+     */
+    void render(std::FILE* out) const
+    {
+        std::string frame;
+        frame.reserve((m_Max.first + 2) * (m_Max.second + 1));
+
+        coord_t p;
+        for (p.second = 0; p.second <= m_Max.second; ++p.second) {
+            for (p.first = 0; p.first <= m_Max.first; ++p.first) {
+                auto elm = m_Map.find(p);
+                if (elm == m_Map.end()) {
+                    frame += '.';
+                    continue;
+                }
+
+                frame += "\033[48;5;57m";
+
+                auto g = std::find_if(s_graphics.begin(), s_graphics.end(), [&](const auto& g) { return g.first == elm->second->type; });
+                if (g != s_graphics.end()) {
+                    frame += g->second;
+                } else {
+                    frame += elm->second->type;
+                }
+
+                frame += "\033[m";
+            }
+            frame += '\n';
+        }
+
+        std::fwrite(frame.data(), 1, frame.size(), out);
+        std::fflush(out);
+    }
+
     void finalize()
     {
         if (m_Map.empty())
@@ -831,6 +868,154 @@ private:
     coord_t m_Start;
 };
 
+/* Row-major char grid of the pipes.  The loop is walked once, the enclosed
+ * area comes from the shoelace formula and the interior tile count from
+ * Pick's theorem, so the work is proportional to the loop length.
+ */
+class FlatGrid
+{
+public:
+    using distance_t = int64_t;
+
+    void addLine(const std::string& s)
+    {
+        if (m_Width == 0) {
+            m_Width = s.size();
+        } else if (s.size() != m_Width) {
+            throw std::invalid_argument("Irregular grid size");
+        }
+
+        auto start = s.find('S');
+        if (start != std::string::npos) {
+            m_Start = m_Cells.size() + start;
+        }
+
+        m_Cells.append(s);
+        m_Height++;
+    }
+
+    void trace()
+    {
+        if (m_Start == std::string::npos)
+            throw std::invalid_argument("Start node not found");
+
+        /* Derive the start symbol from the neighbours pointing back at it */
+        std::bitset<4> key;
+        for (auto& d : Grid::directions) {
+            std::size_t neigh = 0;
+            if (move_to(m_Start, d, neigh) && connects(m_Cells[neigh]).test(opposite(d))) {
+                key.set(d);
+            }
+        }
+
+        m_Cells[m_Start] = '.';
+        for (auto& c : s_connections) {
+            if (key == c.first) {
+                m_Cells[m_Start] = c.second;
+            }
+        }
+
+        if (m_Cells[m_Start] == '.')
+            throw std::invalid_argument("Can't determine start symbol " + key.to_string());
+
+        Direction dir = NORTH;
+        while (!key.test(dir)) {
+            dir = static_cast<Direction>(dir + 1);
+        }
+
+        std::size_t pos = m_Start;
+        m_Length = 0;
+        m_Area2 = 0;
+
+        do {
+            std::size_t next = 0;
+            if (!move_to(pos, dir, next))
+                throw std::invalid_argument("Loop leaves the grid");
+
+            m_Area2 += static_cast<distance_t>(pos % m_Width) * static_cast<distance_t>(next / m_Width)
+                     - static_cast<distance_t>(next % m_Width) * static_cast<distance_t>(pos / m_Width);
+            m_Length++;
+
+            auto exits = connects(m_Cells[next]);
+            if (!exits.test(opposite(dir)))
+                throw std::invalid_argument("Broken loop");
+
+            exits.reset(opposite(dir));
+            for (auto& d : Grid::directions) {
+                if (exits.test(d))
+                    dir = d;
+            }
+            pos = next;
+        } while (pos != m_Start);
+    }
+
+    distance_t getMaxDistance() const
+    {
+        return m_Length / 2;
+    }
+
+    std::size_t getInternalNodes() const
+    {
+        return (std::abs(m_Area2) - m_Length) / 2 + 1;
+    }
+
+private:
+    static std::bitset<4> connects(char c)
+    {
+        for (auto& con : s_connections) {
+            if (con.second == c)
+                return con.first;
+        }
+        return {};
+    }
+
+    static Direction opposite(const Direction& d)
+    {
+        return static_cast<Direction>((d + 2) % 4);
+    }
+
+    bool move_to(std::size_t pos, const Direction& d, std::size_t& next) const
+    {
+        std::size_t x = pos % m_Width;
+        std::size_t y = pos / m_Width;
+
+        switch (d) {
+            case NORTH:
+                if (y == 0)
+                    return false;
+                next = pos - m_Width;
+                break;
+            case EAST:
+                if (x + 1 >= m_Width)
+                    return false;
+                next = pos + 1;
+                break;
+            case SOUTH:
+                if (y + 1 >= m_Height)
+                    return false;
+                next = pos + m_Width;
+                break;
+            case WEST:
+                if (x == 0)
+                    return false;
+                next = pos - 1;
+                break;
+            default:
+                throw std::invalid_argument("Unknown direction");
+        }
+
+        return true;
+    }
+
+    std::string m_Cells;
+    std::size_t m_Width = 0;
+    std::size_t m_Height = 0;
+    std::size_t m_Start = std::string::npos;
+
+    distance_t m_Length = 0;
+    distance_t m_Area2 = 0;
+};
+
 namespace std
 {
     string to_string(const Grid& node)
@@ -850,22 +1035,49 @@ namespace std
 int main(int argc, char** argv)
 {
     if (argc < 2) {
-        std::cerr << "Usage : " << argv[0] << " datafilename " << std::endl << std::endl;
+        std::cerr << "Usage : " << argv[0] << " datafilename [pick] [quiet] [buffered]" << std::endl << std::endl;
+        std::cerr << "  pick     : count the interior from the loop area (shoelace + Pick's theorem)" << std::endl;
+        std::cerr << "  quiet    : don't render the grid" << std::endl;
+        std::cerr << "  buffered : render the grid with a single write" << std::endl;
 
         exit(-1);
     }
 
+    bool with_pick = false;
+    bool with_quiet = false;
+    bool with_buffered = false;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string option(argv[i]);
+        if (option == "pick") {
+            with_pick = true;
+        } else if (option == "quiet") {
+            with_quiet = true;
+        } else if (option == "buffered") {
+            with_buffered = true;
+        } else {
+            std::cerr << "Unknown option " << option << std::endl;
+            exit(-1);
+        }
+    }
+
     Grid grid;
+    FlatGrid flat;
 
     try {
-        with_debug = true || !(std::string(argv[1]) == "input.dat");
+        with_debug = !with_quiet;
 
         std::ifstream infile(argv[1]);
 
         std::string line;
 
         while (std::getline(infile, line)) {
-            if (!line.empty()) {
+            if (line.empty())
+                continue;
+
+            if (with_pick) {
+                flat.addLine(line);
+            } else {
                 grid.addLine(line);
             }
         }
@@ -874,17 +1086,43 @@ int main(int argc, char** argv)
         std::exit(-1);
     }
 
-    grid.finalize();
-    grid.walk();
-    grid.cleanup();
-    grid.scan_inside();
+    if (with_pick) {
+        flat.trace();
+
+        std::cout << "A max distance " << flat.getMaxDistance() << std::endl;
+        std::cout << "B internal nodes " << flat.getInternalNodes() << std::endl;
+
+        return 0;
+    }
+
+    std::vector<std::pair<std::string_view, std::chrono::duration<double, std::milli>>> timings;
+    auto timed = [&](std::string_view name, auto&& fn) {
+        auto begin = std::chrono::steady_clock::now();
+        fn();
+        timings.emplace_back(name, std::chrono::steady_clock::now() - begin);
+    };
+
+    timed("finalize"sv, [&]() { grid.finalize(); });
+    timed("walk"sv, [&]() { grid.walk(); });
+    timed("cleanup"sv, [&]() { grid.cleanup(); });
+    timed("scan_inside"sv, [&]() { grid.scan_inside(); });
 
     if (with_debug) {
-        std::cout << grid << std::endl;
+        if (with_buffered) {
+            std::cout.flush();
+            grid.render(stdout);
+            std::cout << std::endl;
+        } else {
+            std::cout << grid << std::endl;
+        }
     }
 
     std::cout << "A max distance " << grid.getMaxDistance() << std::endl;
     std::cout << "B internal nodes " << grid.getInternalNodes() << std::endl;
 
+    for (auto& t : timings) {
+        std::cout << std::setw(12) << t.first << " " << std::fixed << std::setprecision(3) << t.second.count() << " ms" << std::endl;
+    }
+
     return 0;
 }
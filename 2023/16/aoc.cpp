@@ -348,12 +348,339 @@ public:
        return ret;
     };
 
+    std::size_t width() const { return m_Rows.empty() ? 0 : m_Rows[0].size(); }
+    std::size_t height() const { return m_Rows.size(); }
+
+    /* Cell types in row-major order */
+    std::vector<char> types() const {
+      std::vector<char> ret;
+      ret.reserve(width() * height());
+      for (auto &row : m_Rows) {
+        for (auto &cell : row) {
+          ret.push_back(cell.getType());
+        }
+      }
+      return ret;
+    }
+
   private: 
 
    std::vector<std::vector<Cell>> m_Rows;
     Cell m_Offgrid;
 };
 
+/* Beam tracer on a flat copy of the grid.  Visited directions are kept as a
+ * 4 bit mask per cell and beams waiting to be followed go on an explicit
+ * stack, so a run does no allocations once the buffers have grown.
+ */
+class Tracer
+{
+public:
+  Tracer(const Grid &grid) : m_Width(grid.width()), m_Height(grid.height()), m_Types(grid.types()) {
+    m_Visited.resize(m_Types.size());
+  }
+
+  std::size_t run(const Beam &startpoint = Beam()) {
+    std::fill(m_Visited.begin(), m_Visited.end(), 0);
+
+    std::size_t energized = 0;
+    std::array<Direction, 2> out;
+
+    m_Stack.clear();
+    m_Stack.push_back(startpoint);
+
+    while (!m_Stack.empty()) {
+      Beam b = m_Stack.back();
+      m_Stack.pop_back();
+
+      while (b.pos.x >= 0 && b.pos.y >= 0 && b.pos.x < m_Width && b.pos.y < m_Height) {
+        std::size_t idx = b.pos.y * m_Width + b.pos.x;
+        uint8_t bit = 1 << b.dir;
+
+        if (m_Visited[idx] & bit)
+          break;
+
+        if (m_Visited[idx] == 0)
+          energized++;
+        m_Visited[idx] |= bit;
+
+        if (deflect(m_Types[idx], b.dir, out) == 2) {
+          m_Stack.push_back(b.next(out[1]));
+        }
+        b = b.next(out[0]);
+      }
+    }
+
+    return energized;
+  }
+
+  /* Directions a beam leaves a cell of the given type in, returns how many */
+  static int deflect(char type, Direction dir, std::array<Direction, 2> &out) {
+    switch (type) {
+    case '.':
+      out[0] = dir;
+      return 1;
+    case '|':
+      if (dir == NORTH || dir == SOUTH) {
+        out[0] = dir;
+        return 1;
+      }
+      out = {NORTH, SOUTH};
+      return 2;
+    case '-':
+      if (dir == EAST || dir == WEST) {
+        out[0] = dir;
+        return 1;
+      }
+      out = {EAST, WEST};
+      return 2;
+    case '\\':
+      out[0] = static_cast<Direction>(dir ^ 3);
+      return 1;
+    case '/':
+      out[0] = static_cast<Direction>(dir ^ 1);
+      return 1;
+    default:
+      throw std::invalid_argument("Unknown cell type");
+    }
+  }
+
+private:
+  int m_Width;
+  int m_Height;
+  std::vector<char> m_Types;
+  std::vector<uint8_t> m_Visited;
+  std::vector<Beam> m_Stack;
+};
+
+/* Best number of energized cells over all border entries, spread over a pool
+ * of workers that each own a tracer and its visited buffer.
+ */
+std::size_t sweep(const Grid &grid) {
+  auto border = grid.border();
+  std::vector<Beam> entries(border.begin(), border.end());
+
+  std::atomic<std::size_t> next_entry{0};
+  std::size_t n_workers = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::future<std::size_t>> workers;
+
+  for (std::size_t i = 0; i < n_workers; ++i) {
+    workers.emplace_back(std::async(std::launch::async, [&]() {
+      Tracer tracer(grid);
+      std::size_t best = 0;
+
+      for (std::size_t e = next_entry++; e < entries.size(); e = next_entry++) {
+        best = std::max(best, tracer.run(entries[e]));
+      }
+
+      return best;
+    }));
+  }
+
+  std::size_t best = 0;
+  for (auto &w : workers) {
+    best = std::max(best, w.get());
+  }
+
+  return best;
+}
+
+/* The grid collapsed into a graph of splitters.  A splitter hit on its flat
+ * side fires both outputs, each output runs as a segment until it leaves the
+ * grid or hits the flat side of the next splitter.  The cells energized by
+ * everything reachable from a splitter are computed once per strongly
+ * connected component, after which any start is one bitset OR and popcount.
+ */
+class SegmentGraph
+{
+public:
+  SegmentGraph(const Grid &grid)
+      : m_Width(grid.width()), m_Height(grid.height()), m_Types(grid.types()),
+        m_Words((m_Types.size() + 63) / 64), m_Node(m_Types.size(), -1),
+        m_Stamp(4 * m_Types.size(), 0), m_Scratch(m_Words) {
+
+    for (std::size_t idx = 0; idx < m_Types.size(); ++idx) {
+      if (m_Types[idx] == '|' || m_Types[idx] == '-') {
+        m_Node[idx] = m_Cells.size();
+        m_Cells.push_back(idx);
+      }
+    }
+
+    m_Successors.resize(m_Cells.size());
+    m_Own.assign(m_Cells.size() * m_Words, 0);
+
+    std::vector<std::size_t> cells;
+    for (std::size_t n = 0; n < m_Cells.size(); ++n) {
+      Coord pos(m_Cells[n] % m_Width, m_Cells[n] / m_Width);
+      std::array<Direction, 2> out;
+      Tracer::deflect(m_Types[m_Cells[n]], m_Types[m_Cells[n]] == '|' ? EAST : NORTH, out);
+
+      for (auto &dir : out) {
+        cells.clear();
+        int target = walk(Beam(pos, dir), cells);
+        if (target >= 0) {
+          m_Successors[n].push_back(target);
+        }
+        for (auto &c : cells) {
+          m_Own[n * m_Words + c / 64] |= uint64_t(1) << (c % 64);
+        }
+      }
+    }
+
+    components();
+  }
+
+  std::size_t run(const Beam &startpoint = Beam()) {
+    std::fill(m_Scratch.begin(), m_Scratch.end(), 0);
+
+    std::vector<std::size_t> cells;
+    int target = walk(startpoint, cells);
+
+    for (auto &c : cells) {
+      m_Scratch[c / 64] |= uint64_t(1) << (c % 64);
+    }
+
+    if (target >= 0) {
+      const uint64_t *reach = &m_Reach[m_Component[target] * m_Words];
+      for (std::size_t w = 0; w < m_Words; ++w) {
+        m_Scratch[w] |= reach[w];
+      }
+    }
+
+    std::size_t ret = 0;
+    for (auto &w : m_Scratch) {
+      ret += __builtin_popcountll(w);
+    }
+    return ret;
+  }
+
+private:
+  /* Follow a beam through empty cells, mirrors and splitters hit edge-on.
+   * Returns the splitter node it ends on, or -1 when it leaves the grid or
+   * turns out to run in a loop.
+   */
+  int walk(Beam b, std::vector<std::size_t> &cells) {
+    m_CurrentStamp++;
+
+    while (b.pos.x >= 0 && b.pos.y >= 0 && b.pos.x < m_Width && b.pos.y < m_Height) {
+      std::size_t idx = b.pos.y * m_Width + b.pos.x;
+
+      uint32_t &stamp = m_Stamp[4 * idx + b.dir];
+      if (stamp == m_CurrentStamp)
+        return -1;
+      stamp = m_CurrentStamp;
+
+      cells.push_back(idx);
+
+      std::array<Direction, 2> out;
+      if (Tracer::deflect(m_Types[idx], b.dir, out) == 2)
+        return m_Node[idx];
+
+      b = b.next(out[0]);
+    }
+
+    return -1;
+  }
+
+  /* Iterative Tarjan.  Components complete in reverse topological order, so
+   * the reach of every successor component is known when a component closes.
+   */
+  void components() {
+    const std::size_t n_nodes = m_Cells.size();
+    std::vector<int> index(n_nodes, -1);
+    std::vector<int> lowlink(n_nodes, 0);
+    std::vector<bool> on_stack(n_nodes, false);
+    std::vector<int> stack;
+    std::vector<std::pair<int, std::size_t>> call;
+    int counter = 0;
+
+    m_Component.assign(n_nodes, -1);
+
+    for (std::size_t root = 0; root < n_nodes; ++root) {
+      if (index[root] >= 0)
+        continue;
+
+      call.emplace_back(root, 0);
+
+      while (!call.empty()) {
+        auto &[v, edge] = call.back();
+
+        if (edge == 0 && index[v] < 0) {
+          index[v] = lowlink[v] = counter++;
+          stack.push_back(v);
+          on_stack[v] = true;
+        }
+
+        if (edge < m_Successors[v].size()) {
+          int w = m_Successors[v][edge++];
+          if (index[w] < 0) {
+            call.emplace_back(w, 0);
+          } else if (on_stack[w]) {
+            lowlink[v] = std::min(lowlink[v], index[w]);
+          }
+          continue;
+        }
+
+        int done = v;
+        call.pop_back();
+
+        if (!call.empty()) {
+          int parent = call.back().first;
+          lowlink[parent] = std::min(lowlink[parent], lowlink[done]);
+        }
+
+        if (lowlink[done] == index[done]) {
+          closeComponent(done, stack, on_stack);
+        }
+      }
+    }
+  }
+
+  void closeComponent(int root, std::vector<int> &stack, std::vector<bool> &on_stack) {
+    const std::size_t comp = m_Reach.size() / m_Words;
+    m_Reach.resize(m_Reach.size() + m_Words, 0);
+
+    std::vector<int> members;
+    int w;
+    do {
+      w = stack.back();
+      stack.pop_back();
+      on_stack[w] = false;
+      m_Component[w] = comp;
+      members.push_back(w);
+    } while (w != root);
+
+    uint64_t *reach = &m_Reach[comp * m_Words];
+    for (auto &m : members) {
+      for (std::size_t i = 0; i < m_Words; ++i) {
+        reach[i] |= m_Own[m * m_Words + i];
+      }
+      for (auto &succ : m_Successors[m]) {
+        if (m_Component[succ] == int(comp))
+          continue;
+        const uint64_t *other = &m_Reach[m_Component[succ] * m_Words];
+        for (std::size_t i = 0; i < m_Words; ++i) {
+          reach[i] |= other[i];
+        }
+      }
+    }
+  }
+
+  int m_Width;
+  int m_Height;
+  std::vector<char> m_Types;
+  std::size_t m_Words;
+  std::vector<int> m_Node;
+  std::vector<std::size_t> m_Cells;
+  std::vector<std::vector<int>> m_Successors;
+  std::vector<uint64_t> m_Own;
+  std::vector<int> m_Component;
+  std::vector<uint64_t> m_Reach;
+  std::vector<uint32_t> m_Stamp;
+  uint32_t m_CurrentStamp = 0;
+  std::vector<uint64_t> m_Scratch;
+};
+
 namespace std
 {
     string to_string(const Grid& node)
@@ -404,14 +731,19 @@ int main(int argc, char** argv)
       std::cout << grid << std::endl;
     }
 
+    SegmentGraph segments(grid);
+
     std::size_t best = 0;
     for (auto &beam : grid.border()) {
-      auto n_energized = grid.run(beam);
-      best = std::max(best, n_energized);
+      best = std::max(best, segments.run(beam));
     }
 
     std::cout << "Cells energized B " << best << std::endl;
 
+    if (with_debug) {
+      std::cout << "Cells energized B (tracer) " << sweep(grid) << std::endl;
+    }
+
 
     return 0;
 }